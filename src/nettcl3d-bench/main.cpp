@@ -0,0 +1,283 @@
+/*
+ * main.cpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+/*
+ * Benchmark of simulation kernels on Grid3d networks of increasing size.
+ *
+ * Usage: nettcl3d-bench ?maxSize? ?simd? ?threads?
+ *
+ * Prints CSV to standard output, one row per kernel and network size:
+ *   kernel,size,contacts,circuits,calls,seconds,nsPerContact
+ * where nsPerContact is time of a single call divided by number of
+ * contacts, so flat curve over size means linear scaling. Tracers write
+ * to /dev/null.
+ */
+
+#include <stdlib.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../nettcl3d/calc/network.hpp"
+#include "../nettcl3d/calc/incidence.hpp"
+#include "../nettcl3d/calc/integrator.hpp"
+#include "../nettcl3d/calc/run_stats.hpp"
+#include "../nettcl3d/populator/grid3d.hpp"
+#include "../nettcl3d/rng/uniform_rng.hpp"
+#include "../nettcl3d/tracer/avg_voltage.hpp"
+#include "../nettcl3d/tracer/avg_flux.hpp"
+#include "../nettcl3d/tracer/voltage.hpp"
+#include "../nettcl3d/tracer/flux.hpp"
+#include "../nettcl3d/tracer/flux_section.hpp"
+
+namespace {
+
+	// every measurement is repeated until it takes at least this long, seconds
+	const double minTime = 0.2;
+
+	const char* const nullFile = "/dev/null";
+
+	struct Setup {
+		unsigned maxSize;
+		std::string simd;
+		unsigned threads;
+
+		Setup() : maxSize(32), simd("auto"), threads(1) {}
+	};
+
+	void report(const char* const kernel, unsigned const size, const Network& network, unsigned long const calls, double const seconds) {
+		std::cout << kernel << ',' << size << ','
+			<< network.getNumOfContacts() << ',' << network.getNumOfCircuits() << ','
+			<< calls << ',' << seconds << ','
+			<< seconds * 1.0e9 / calls / network.getNumOfContacts() << std::endl;
+	}
+
+	/*
+	 * Calls op() in batches of growing size until total time exceeds minTime.
+	 */
+	template <typename Op>
+	void measure(const char* const kernel, unsigned const size, const Network& network, Op& op) {
+		unsigned long calls = 0;
+		double seconds = 0.0;
+
+		for (unsigned long batch = 1; seconds < minTime; batch *= 2) {
+			const RunStats::Stopwatch watch;
+			for (unsigned long i = 0; i < batch; ++i) {
+				op();
+			}
+			seconds += watch.elapsed();
+			calls += batch;
+		}
+
+		report(kernel, size, network, calls, seconds);
+	}
+
+	/*
+	 * Right hand side is timed by integrator itself (see RunStats), so only
+	 * evaluations made by solver are counted, without step control.
+	 */
+	void benchRhs(const Setup& setup, unsigned const size, Network& network) {
+		Integrator::Params params;
+		params.simd = setup.simd;
+		params.threads = setup.threads;
+		params.stepper = "rkf45";
+
+		Integrator integrator(params);
+		double time = 0.0;
+		do {
+			integrator.advance(network, time, time + 1.0);
+			time += 1.0;
+		} while (integrator.getStats().rhsTime < minTime);
+
+		const RunStats& stats = integrator.getStats();
+		report("rhs", size, network, stats.rhsEvaluations, stats.rhsTime);
+	}
+
+	struct CircuitPhases {
+		Incidence incidence;
+		std::vector<double> dest;
+		const Network::ValueVector& phases;
+
+		CircuitPhases(const Network& network) : dest(network.getNumOfCircuits()), phases(network.getPhases()) {
+			incidence.build(network);
+		}
+
+		void operator()() {
+			incidence.circuitPhases(&phases[0], &dest[0]);
+		}
+	};
+
+	struct Flux {
+		const Network& network;
+		std::vector<double> dest;
+
+		Flux(const Network& network) : network(network), dest(network.getNumOfCircuits()) {}
+
+		void operator()() {
+			for (std::size_t i = 0, n = dest.size(); i < n; ++i) {
+				dest[i] = network.flux(i);
+			}
+		}
+	};
+
+	struct Matches {
+		const Network& network;
+		const std::string expr;
+		std::size_t count;
+
+		Matches(const Network& network, const std::string& expr) : network(network), expr(expr), count(0) {}
+
+		void operator()() {
+			for (std::size_t i = 0, n = network.getNumOfContacts(); i < n; ++i) {
+				if (network.contactTagable(i).matches(expr)) {
+					++count;
+				}
+			}
+		}
+	};
+
+	struct Iteration {
+		AbstractTracer& tracer;
+		const Network& network;
+		double time;
+
+		Iteration(AbstractTracer& tracer, const Network& network) : tracer(tracer), network(network), time(0.0) {
+			tracer.beforeRun(network, 0.0, 1.0e9, 1.0);
+		}
+
+		~Iteration() {
+			tracer.afterRun(network);
+		}
+
+		void operator()() {
+			tracer.afterIteration(network, time);
+			time += 1.0;
+		}
+	};
+
+	// flux section does its work after run
+	struct AfterRun {
+		AbstractTracer& tracer;
+		const Network& network;
+
+		AfterRun(AbstractTracer& tracer, const Network& network) : tracer(tracer), network(network) {}
+
+		void operator()() {
+			tracer.beforeRun(network, 0.0, 1.0, 1.0);
+			tracer.afterRun(network);
+		}
+	};
+
+	template <typename Tracer>
+	void benchTracer(const char* const kernel, unsigned const size, const Network& network, const typename Tracer::Params& params) {
+		Tracer tracer(params);
+		Iteration op(tracer, network);
+		measure(kernel, size, network, op);
+	}
+
+	template <typename Params>
+	Params indexParams(std::size_t const n) {
+		Params params;
+		params.fileNameFormat = nullFile;
+		for (unsigned i = 0; i < 10 && i < n; ++i) {
+			params.indices.insert(i);
+		}
+		return params;
+	}
+
+	void bench(const Setup& setup, unsigned const size) {
+		rng::Uniform beta(1.0, 0.2), tau(1.0, 0.2), v(1.0, 0.1);
+		populator::Grid3d populator(populator::Grid3d::Params(size, size, size, beta, tau, v));
+
+		Network network;
+		populator.populate(network);
+		for (std::size_t i = 0, n = network.getNumOfContacts(); i < n; ++i) {
+			network.setH(i, Point(1.0, 1.5, 2.0));
+		}
+
+		// brings the network off rest, so that kernels see generic state
+		benchRhs(setup, size, network);
+
+		{
+			CircuitPhases op(network);
+			measure("circuit-phases", size, network, op);
+		}
+
+		{
+			Flux op(network);
+			measure("flux", size, network, op);
+		}
+
+		{
+			Matches op(network, "x & boundary");
+			measure("matches", size, network, op);
+		}
+
+		{
+			tracer::AverageVoltage::Params params;
+			params.fileName = nullFile;
+			benchTracer<tracer::AverageVoltage>("tracer-avg-voltage", size, network, params);
+		}
+
+		{
+			tracer::AverageFlux::Params params;
+			params.fileName = nullFile;
+			benchTracer<tracer::AverageFlux>("tracer-avg-flux", size, network, params);
+		}
+
+		benchTracer<tracer::Voltage>("tracer-voltage", size, network, indexParams<tracer::Voltage::Params>(network.getNumOfContacts()));
+		benchTracer<tracer::Flux>("tracer-flux", size, network, indexParams<tracer::Flux::Params>(network.getNumOfCircuits()));
+
+		{
+			tracer::FluxSection::Params params;
+			params.fileName = nullFile;
+			params.plane = tracer::FluxSection::Params::Z;
+			params.position = size / 2;
+			tracer::FluxSection tracer(params);
+			AfterRun op(tracer, network);
+			measure("tracer-flux-section", size, network, op);
+		}
+	}
+
+}
+
+int main(int argc, char* argv[]) {
+	Setup setup;
+	if (argc > 1) {
+		setup.maxSize = static_cast<unsigned>(atoi(argv[1]));
+	}
+	if (argc > 2) {
+		setup.simd = argv[2];
+	}
+	if (argc > 3) {
+		setup.threads = static_cast<unsigned>(atoi(argv[3]));
+	}
+
+	if (argc > 4 || setup.maxSize < 2 || !ContactKernel::isSupported(setup.simd)) {
+		std::cerr << "Usage: " << argv[0] << " ?maxSize? ?simd? ?threads?" << std::endl;
+		return 1;
+	}
+
+	try {
+		std::cout << "kernel,size,contacts,circuits,calls,seconds,nsPerContact" << std::endl;
+
+		static const unsigned sizes[] = {2, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128};
+		for (std::size_t i = 0; i < sizeof(sizes) / sizeof(*sizes) && sizes[i] <= setup.maxSize; ++i) {
+			bench(setup, sizes[i]);
+		}
+	} catch (const std::exception& ex) {
+		std::cerr << ex.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
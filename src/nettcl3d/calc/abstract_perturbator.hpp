@@ -15,6 +15,7 @@
 #define CALC_ABSTRACT_PERTURBATOR_HPP_
 
 #include <phlib/cloneable.hpp>
+#include "field_drive.hpp"
 
 class AbstractPerturbator : public phlib::Cloneable {
 
@@ -24,6 +25,10 @@ class AbstractPerturbator : public phlib::Cloneable {
 
 	virtual void doSetZ(Network& network, Network::index_type index, double const time) = 0;
 
+	virtual const FieldDrive* doGetFieldDrive() const {
+		return 0;
+	}
+
 public:
 
 	void beforeRun(Network& network, double const startTime, double const endTime, double const dt) {
@@ -38,6 +43,14 @@ public:
 		doSetZ(network, index, time);
 	}
 
+	/*
+	 * Time-dependent field evaluated by integrator during the run, null if
+	 * perturbator changes the network before the run only.
+	 */
+	const FieldDrive* fieldDrive() const {
+		return doGetFieldDrive();
+	}
+
 };
 
 #endif /* CALC_ABSTRACT_PERTURBATOR_HPP_ */
@@ -0,0 +1,197 @@
+/*
+ * calc/batch.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_BATCH_HPP_
+#define CALC_BATCH_HPP_
+
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include "network.hpp"
+#include "integrator.hpp"
+#include "sweep.hpp"
+#include "../util/thread_pool.hpp"
+
+/*
+ * Runs independent jobs on different networks in parallel, one network
+ * per thread. A job is either a plain run or a sweep. Jobs are handed out
+ * one at a time, most expensive first, so that threads finishing cheap
+ * jobs take the remaining ones and no thread idles while others work.
+ * Every job has its own integrator with given parameters, tracers and
+ * perturbators are not used. Checkpoint and stats files of a job are
+ * suffixed by its index, as those of ensemble networks are.
+ */
+class Batch {
+public:
+
+	struct Job {
+		Network* network;
+		double startTime, endTime, dt;
+		bool sweep;
+		Sweep::Params sweepParams;
+
+		// results
+		double voltage;	// mean voltage at the end of run
+		Sweep::ResultVector sweepResults;
+
+		Job() : network(0), startTime(0.0), endTime(0.0), dt(0.0), sweep(false), voltage(0.0) {}
+	};
+
+	typedef std::vector<Job> JobVector;
+
+	Batch(const Integrator::Params& params) : params(params) {}
+
+	void add(const Job& job) {
+		jobs.push_back(job);
+	}
+
+	const JobVector& getJobs() const {
+		return jobs;
+	}
+
+	void run() {
+		std::set<const Network*> networks;
+		for (JobVector::const_iterator i = jobs.begin(), last = jobs.end(); i != last; ++i) {
+			if (!networks.insert(i->network).second) {
+				throw std::invalid_argument("every job must have its own network");
+			}
+			if (i->sweep) {
+				Sweep::validate(i->sweepParams);
+			}
+		}
+
+		costs.resize(jobs.size());
+		order.resize(jobs.size());
+		for (std::size_t i = 0; i < jobs.size(); ++i) {
+			costs[i] = cost(jobs[i]);
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), CostGreater(costs));
+
+		Integrator::Params jobParams = params;
+		jobParams.threads = 1;
+		const unsigned numOfThreads = params.threads > 0 ? params.threads : ThreadPool::hardwareConcurrency();
+
+		errors.clear();
+		JobTask task(*this, jobParams);
+		ThreadPool pool(std::min<unsigned>(numOfThreads, std::max<std::size_t>(jobs.size(), 1)));
+		pool.run(task, jobs.size(), 1);
+
+		if (!errors.empty()) {
+			throw std::runtime_error(errors);
+		}
+	}
+
+private:
+
+	const Integrator::Params params;
+	JobVector jobs;
+	std::vector<double> costs;
+	std::vector<std::size_t> order;
+	boost::mutex errorMutex;
+	std::string errors;
+
+	// integration time times size of the system
+	static double cost(const Job& job) {
+		double time = job.endTime - job.startTime;
+		if (job.sweep) {
+			const std::size_t points = Sweep::values(job.sweepParams).size();
+			time = points * (job.sweepParams.settleTime + job.sweepParams.measureTime);
+		}
+		return time * job.network->getNumOfContacts();
+	}
+
+	struct CostGreater {
+
+		const std::vector<double>& costs;
+
+		CostGreater(const std::vector<double>& costs) : costs(costs) {}
+
+		bool operator()(std::size_t const a, std::size_t const b) const {
+			return costs[a] > costs[b];
+		}
+
+	};
+
+	struct JobTask : public ThreadPool::Task {
+
+		Batch& batch;
+		const Integrator::Params& params;
+
+		JobTask(Batch& batch, const Integrator::Params& params) : batch(batch), params(params) {}
+
+		// jobs run at the same time, so must not share files
+		Integrator::Params jobParams(std::size_t const index) const {
+			Integrator::Params result = params;
+			result.checkpointFile = suffixed(params.checkpointFile, index);
+			result.statsFile = suffixed(params.statsFile, index);
+			return result;
+		}
+
+		static std::string suffixed(const std::string& fileName, std::size_t const index) {
+			if (fileName.empty()) {
+				return fileName;
+			}
+
+			std::stringstream s;
+			s << fileName << '.' << index;
+			return s.str();
+		}
+
+		virtual void operator()(std::size_t const first, std::size_t const last) {
+			for (std::size_t i = first; i < last; ++i) {
+				try {
+					const std::size_t index = batch.order[i];
+					batch.runJob(batch.jobs[index], jobParams(index));
+				} catch (std::exception& ex) {
+					batch.addError(ex.what());
+				} catch (...) {
+					// nothing may leave a worker thread
+					batch.addError("unexpected error");
+				}
+			}
+		}
+
+	};
+
+	void addError(const std::string& msg) {
+		boost::mutex::scoped_lock lock(errorMutex);
+		errors += errors.empty() ? "" : "\n";
+		errors += msg;
+	}
+
+	static void runJob(Job& job, const Integrator::Params& params) {
+		Integrator integrator(params);
+
+		if (job.sweep) {
+			job.sweepResults = Sweep(integrator, job.sweepParams).run(*job.network);
+			return;
+		}
+
+		integrator.run(*job.network, job.startTime, job.endTime, job.dt);
+
+		const Network::ValueVector& voltages = job.network->getVoltages();
+		double sum = 0.0;
+		for (Network::ValueVector::const_iterator i = voltages.begin(), last = voltages.end(); i != last; ++i) {
+			sum += *i;
+		}
+		job.voltage = voltages.empty() ? 0.0 : sum / voltages.size();
+	}
+
+};
+
+#endif /* CALC_BATCH_HPP_ */
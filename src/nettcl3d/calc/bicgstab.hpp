@@ -0,0 +1,174 @@
+/*
+ * calc/bicgstab.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_BICGSTAB_HPP_
+#define CALC_BICGSTAB_HPP_
+
+#include <math.h>
+#include <vector>
+
+/*
+ * Preconditioned BiCGSTAB solver of A * x = b for non-symmetric sparse
+ * matrices given as operators. Operator and preconditioner are functors
+ * with signature void (const double* x, double* dest).
+ */
+class BiCgStab {
+public:
+
+	BiCgStab() : tolerance(1.0e-10), maxIterations(500), iterations(0) {}
+
+	void setTolerance(double const tolerance) {
+		this->tolerance = tolerance;
+	}
+
+	void setMaxIterations(unsigned const maxIterations) {
+		this->maxIterations = maxIterations;
+	}
+
+	/*
+	 * Number of iterations made by the last solve call.
+	 */
+	unsigned getIterations() const {
+		return iterations;
+	}
+
+	/*
+	 * x holds initial guess on entry and solution on exit.
+	 * Returns true if relative residual dropped below tolerance.
+	 */
+	template <typename Operator, typename Preconditioner>
+	bool solve(std::size_t const n, Operator& op, Preconditioner& precond, const double b[], double x[]) {
+		resize(n);
+
+		double* const r = &rv[0];
+		double* const r0 = &r0v[0];
+		double* const p = &pv[0];
+		double* const v = &vv[0];
+		double* const s = &sv[0];
+		double* const t = &tv[0];
+		double* const ph = &phv[0];
+		double* const sh = &shv[0];
+
+		iterations = 0;
+
+		const double bNorm = norm(n, b);
+		if (0.0 == bNorm) {
+			for (std::size_t i = 0; i < n; ++i) {
+				x[i] = 0.0;
+			}
+			return true;
+		}
+		const double limit = tolerance * bNorm;
+
+		op(x, r);
+		for (std::size_t i = 0; i < n; ++i) {
+			r[i] = b[i] - r[i];
+			r0[i] = r[i];
+			p[i] = v[i] = 0.0;
+		}
+
+		if (norm(n, r) <= limit) {
+			return true;
+		}
+
+		double rho = 1.0, alpha = 1.0, omega = 1.0;
+
+		while (iterations < maxIterations) {
+			++iterations;
+
+			const double rhoNew = dot(n, r0, r);
+			if (0.0 == rhoNew || 0.0 == omega) {
+				return false;
+			}
+
+			const double beta = (rhoNew / rho) * (alpha / omega);
+			for (std::size_t i = 0; i < n; ++i) {
+				p[i] = r[i] + beta * (p[i] - omega * v[i]);
+			}
+
+			precond(p, ph);
+			op(ph, v);
+
+			const double r0v = dot(n, r0, v);
+			if (0.0 == r0v) {
+				return false;
+			}
+			alpha = rhoNew / r0v;
+
+			for (std::size_t i = 0; i < n; ++i) {
+				s[i] = r[i] - alpha * v[i];
+			}
+
+			if (norm(n, s) <= limit) {
+				for (std::size_t i = 0; i < n; ++i) {
+					x[i] += alpha * ph[i];
+				}
+				return true;
+			}
+
+			precond(s, sh);
+			op(sh, t);
+
+			const double tt = dot(n, t, t);
+			omega = tt > 0.0 ? dot(n, t, s) / tt : 0.0;
+
+			for (std::size_t i = 0; i < n; ++i) {
+				x[i] += alpha * ph[i] + omega * sh[i];
+				r[i] = s[i] - omega * t[i];
+			}
+
+			if (norm(n, r) <= limit) {
+				return true;
+			}
+
+			rho = rhoNew;
+		}
+
+		return false;
+	}
+
+private:
+
+	double tolerance;
+	unsigned maxIterations;
+	unsigned iterations;
+	std::vector<double> rv, r0v, pv, vv, sv, tv, phv, shv;
+
+	void resize(std::size_t const n) {
+		if (rv.size() != n) {
+			rv.resize(n);
+			r0v.resize(n);
+			pv.resize(n);
+			vv.resize(n);
+			sv.resize(n);
+			tv.resize(n);
+			phv.resize(n);
+			shv.resize(n);
+		}
+	}
+
+	static double dot(std::size_t const n, const double a[], const double b[]) {
+		double sum = 0.0;
+		for (std::size_t i = 0; i < n; ++i) {
+			sum += a[i] * b[i];
+		}
+		return sum;
+	}
+
+	static double norm(std::size_t const n, const double a[]) {
+		return sqrt(dot(n, a, a));
+	}
+
+};
+
+#endif /* CALC_BICGSTAB_HPP_ */
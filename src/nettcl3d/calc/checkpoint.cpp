@@ -0,0 +1,322 @@
+/*
+ * calc/checkpoint.cpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <boost/cstdint.hpp>
+#include "checkpoint.hpp"
+
+/*
+ * Layout:
+ *   magic "NT3DCKPT", uint32 version, uint32 byte order mark,
+ *   double time, double origin, double dt, uint64 steps, double step,
+ *   uint64 number of contacts, arrays of beta, tau, v, h, hNormal, phase,
+ *   voltage, int64 winding (since version 2), tags and properties of every
+ *   contact,
+ *   uint64 number of circuits, every circuit as square, tags and
+ *   properties, uint64 number of contacts and (uint64 index, double gain,
+ *   double weight) of every contact.
+ * Strings and containers are prefixed by uint64 size.
+ */
+
+namespace {
+
+	const char magic[8] = {'N', 'T', '3', 'D', 'C', 'K', 'P', 'T'};
+	const boost::uint32_t byteOrderMark = 0x01020304;
+
+	class Writer {
+	public:
+
+		explicit Writer(std::ostream& s) : s(s) {}
+
+		template <typename T>
+		void value(const T& v) {
+			s.write(reinterpret_cast<const char*>(&v), sizeof(v));
+		}
+
+		void size(std::size_t const v) {
+			value(static_cast<boost::uint64_t>(v));
+		}
+
+		void string(const std::string& v) {
+			size(v.size());
+			s.write(v.data(), v.size());
+		}
+
+		void point(const Point& v) {
+			value(v.x);
+			value(v.y);
+			value(v.z);
+		}
+
+		void values(const Network::ValueVector& v) {
+			if (!v.empty()) {
+				s.write(reinterpret_cast<const char*>(&v[0]), v.size() * sizeof(double));
+			}
+		}
+
+		void windings(const Network::WindingVector& v) {
+			for (Network::WindingVector::const_iterator i = v.begin(), last = v.end(); i != last; ++i) {
+				value(static_cast<boost::int64_t>(*i));
+			}
+		}
+
+		void points(const Network::PointVector& v) {
+			for (Network::PointVector::const_iterator i = v.begin(), last = v.end(); i != last; ++i) {
+				point(*i);
+			}
+		}
+
+		void tagable(const Tagable& t) {
+			size(t.tags.size());
+			for (Tagable::TagContainer::const_iterator i = t.tags.begin(), last = t.tags.end(); i != last; ++i) {
+				string(*i);
+			}
+
+			size(t.props.size());
+			for (Tagable::PropContainer::const_iterator i = t.props.begin(), last = t.props.end(); i != last; ++i) {
+				string(i->first);
+				string(i->second);
+			}
+		}
+
+	private:
+
+		std::ostream& s;
+
+	};
+
+	class Reader {
+	public:
+
+		explicit Reader(std::istream& s) : s(s) {}
+
+		template <typename T>
+		T value() {
+			T v;
+			read(reinterpret_cast<char*>(&v), sizeof(v));
+			return v;
+		}
+
+		std::size_t size() {
+			const boost::uint64_t v = value<boost::uint64_t>();
+			if (v > static_cast<boost::uint64_t>(std::size_t(-1) / sizeof(double))) {
+				throw Checkpoint::FormatError("size is out of range");
+			}
+			return static_cast<std::size_t>(v);
+		}
+
+		std::string string() {
+			std::string v(size(), '\0');
+			if (!v.empty()) {
+				read(&v[0], v.size());
+			}
+			return v;
+		}
+
+		Point point() {
+			Point v;
+			v.x = value<double>();
+			v.y = value<double>();
+			v.z = value<double>();
+			return v;
+		}
+
+		void values(Network::ValueVector& v, std::size_t const n) {
+			v.resize(n);
+			if (n > 0) {
+				read(reinterpret_cast<char*>(&v[0]), n * sizeof(double));
+			}
+		}
+
+		void windings(Network::WindingVector& v, std::size_t const n) {
+			v.resize(n);
+			for (std::size_t i = 0; i < n; ++i) {
+				v[i] = static_cast<long>(value<boost::int64_t>());
+			}
+		}
+
+		void points(Network::PointVector& v, std::size_t const n) {
+			v.resize(n);
+			for (std::size_t i = 0; i < n; ++i) {
+				v[i] = point();
+			}
+		}
+
+		void tagable(Tagable& t) {
+			for (std::size_t i = 0, n = size(); i < n; ++i) {
+				t.addTag(string());
+			}
+
+			for (std::size_t i = 0, n = size(); i < n; ++i) {
+				const std::string name = string();
+				t.props[name] = string();
+			}
+		}
+
+		void read(char* const dest, std::size_t const n) {
+			s.read(dest, n);
+			if (static_cast<std::size_t>(s.gcount()) != n) {
+				throw Checkpoint::FormatError("unexpected end of data");
+			}
+		}
+
+	private:
+
+		std::istream& s;
+
+	};
+
+}
+
+void Checkpoint::save(std::ostream& s, const Network& network) const {
+	Writer w(s);
+
+	s.write(magic, sizeof(magic));
+	w.value(static_cast<boost::uint32_t>(version));
+	w.value(byteOrderMark);
+	w.value(time);
+	w.value(origin);
+	w.value(dt);
+	w.value(static_cast<boost::uint64_t>(steps));
+	w.value(step);
+
+	const std::size_t numOfContacts = network.getNumOfContacts();
+	w.size(numOfContacts);
+	w.values(network.getBetas());
+	w.values(network.getTaus());
+	w.values(network.getVs());
+	w.points(network.getHs());
+	w.points(network.getHNormals());
+	w.values(network.getPhases());
+	w.values(network.getVoltages());
+	w.windings(network.getWindings());
+	for (std::size_t i = 0; i < numOfContacts; ++i) {
+		w.tagable(network.contactTagable(i));
+	}
+
+	w.size(network.getNumOfCircuits());
+	for (Network::circuit_const_iterator c = network.circuitBegin(), last = network.circuitEnd(); c != last; ++c) {
+		w.value(c->square);
+		w.tagable(*c);
+		w.size(c->contactRefs.size());
+		for (Circuit::const_iterator i = c->begin(), end = c->end(); i != end; ++i) {
+			w.size(i->index);
+			w.value(i->gain);
+			w.value(i->weight);
+		}
+	}
+
+	if (!s) {
+		throw std::runtime_error("error writing checkpoint");
+	}
+}
+
+void Checkpoint::load(std::istream& s, Network& network) {
+	Reader r(s);
+
+	char m[sizeof(magic)];
+	r.read(m, sizeof(m));
+	if (memcmp(m, magic, sizeof(magic))) {
+		throw FormatError("not a checkpoint");
+	}
+
+	const boost::uint32_t fileVersion = r.value<boost::uint32_t>();
+	if (fileVersion < 1 || fileVersion > version) {
+		throw FormatError("unsupported version");
+	}
+
+	if (r.value<boost::uint32_t>() != byteOrderMark) {
+		throw FormatError("byte order differs");
+	}
+
+	Checkpoint header;
+	header.time = r.value<double>();
+	header.origin = r.value<double>();
+	header.dt = r.value<double>();
+	header.steps = static_cast<unsigned long>(r.value<boost::uint64_t>());
+	header.step = r.value<double>();
+
+	const std::size_t numOfContacts = r.size();
+	Network::ValueVector betas, taus, vs, phases, voltages;
+	Network::WindingVector windings(numOfContacts, 0);
+	Network::PointVector hs, hNormals;
+	r.values(betas, numOfContacts);
+	r.values(taus, numOfContacts);
+	r.values(vs, numOfContacts);
+	r.points(hs, numOfContacts);
+	r.points(hNormals, numOfContacts);
+	r.values(phases, numOfContacts);
+	r.values(voltages, numOfContacts);
+	if (fileVersion >= 2) {
+		r.windings(windings, numOfContacts);
+	}
+
+	Network result;
+	for (std::size_t i = 0; i < numOfContacts; ++i) {
+		Contact c(betas[i], taus[i], vs[i]);
+		c.h = hs[i];
+		c.hNormal = hNormals[i];
+		c.phase = phases[i];
+		c.voltage = voltages[i];
+		r.tagable(c);
+		result.addContact(c);
+	}
+
+	for (std::size_t k = 0, numOfCircuits = r.size(); k < numOfCircuits; ++k) {
+		Circuit c(r.value<double>());
+		r.tagable(c);
+		for (std::size_t i = 0, n = r.size(); i < n; ++i) {
+			const std::size_t index = r.size();
+			if (index >= numOfContacts) {
+				throw FormatError("contact index is out of range");
+			}
+			const double gain = r.value<double>();
+			c.addContactRef(ContactRef(index, gain, r.value<double>()));
+		}
+		result.addCircuit(c);
+	}
+
+	result.getWindings().swap(windings);
+	network.swap(result);
+	*this = header;
+}
+
+void Checkpoint::save(const std::string& fileName, const Network& network) const {
+	const std::string tempName = fileName + ".tmp";
+
+	{
+		std::ofstream s(tempName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!s) {
+			throw std::runtime_error("cannot create file " + tempName);
+		}
+		save(s, network);
+		s.close();
+		if (!s) {
+			throw std::runtime_error("error writing file " + tempName);
+		}
+	}
+
+	if (::rename(tempName.c_str(), fileName.c_str())) {
+		throw std::runtime_error("cannot rename file " + tempName);
+	}
+}
+
+void Checkpoint::load(const std::string& fileName, Network& network) {
+	std::ifstream s(fileName.c_str(), std::ios::in | std::ios::binary);
+	if (!s) {
+		throw std::runtime_error("cannot open file " + fileName);
+	}
+	load(s, network);
+}
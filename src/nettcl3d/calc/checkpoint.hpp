@@ -0,0 +1,62 @@
+/*
+ * calc/checkpoint.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_CHECKPOINT_HPP_
+#define CALC_CHECKPOINT_HPP_
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "network.hpp"
+
+/*
+ * Binary snapshot of a network: contact parameters and state, circuits,
+ * tags and properties, along with position on the time grid of the run
+ * and integration step size so that an interrupted run can be resumed
+ * exactly.
+ * Values are stored in native byte order, a snapshot made on a machine
+ * with different byte order is rejected.
+ */
+class Checkpoint {
+public:
+
+	static const unsigned version = 2;
+
+	struct FormatError : public std::runtime_error {
+
+		FormatError(const std::string& msg) : std::runtime_error("wrong checkpoint: " + msg) {}
+
+	};
+
+	double time;
+	double origin, dt;	// time = origin + steps * dt
+	unsigned long steps;
+	double step;	// 0 if unknown
+
+	Checkpoint() : time(0.0), origin(0.0), dt(0.0), steps(0), step(0.0) {}
+
+	void save(std::ostream& s, const Network& network) const;
+
+	void load(std::istream& s, Network& network);
+
+	/*
+	 * File is replaced atomically, so a crash during saving leaves the
+	 * previous snapshot intact.
+	 */
+	void save(const std::string& fileName, const Network& network) const;
+
+	void load(const std::string& fileName, Network& network);
+
+};
+
+#endif /* CALC_CHECKPOINT_HPP_ */
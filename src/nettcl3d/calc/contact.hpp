@@ -20,6 +20,10 @@
 #include "point.hpp"
 #include "tagable.hpp"
 
+/*
+ * Contact record used to populate networks.
+ * Network splits it into per-field arrays on insertion.
+ */
 struct Contact : public Tagable {
 
 	double beta, tau, v;
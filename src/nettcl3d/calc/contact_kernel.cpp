@@ -0,0 +1,257 @@
+/*
+ * calc/contact_kernel.cpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include <math.h>
+#include <string.h>
+#include "contact_kernel.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CONTACT_KERNEL_X86
+#endif
+
+namespace {
+
+	void scalarKernel(
+			std::size_t const n,
+			const double* const phi,
+			const double* const u,
+			const double* const drive,
+			const double* const invBeta,
+			const double* const tauBeta,
+			const double* const vBeta,
+			double* const du) {
+
+		for (std::size_t i = 0; i < n; ++i) {
+			du[i] = invBeta[i] * drive[i] - tauBeta[i] * u[i] - vBeta[i] * sin(phi[i]);
+		}
+	}
+
+#ifdef CONTACT_KERNEL_X86
+
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+	typedef double v2df __attribute__((vector_size(16)));
+	typedef long long v2di __attribute__((vector_size(16)));
+	typedef double v4df __attribute__((vector_size(32)));
+	typedef long long v4di __attribute__((vector_size(32)));
+	typedef double v8df __attribute__((vector_size(64)));
+	typedef long long v8di __attribute__((vector_size(64)));
+
+	/*
+	 * Vectors are passed by reference only: helpers are instantiated
+	 * outside the functions enabling the instruction set, where AVX vector
+	 * passed by value would have different calling convention.
+	 */
+
+	// unaligned load and store
+	template <typename V>
+	ALWAYS_INLINE void load(V& v, const double* const p) {
+		memcpy(&v, p, sizeof(V));
+	}
+
+	template <typename V>
+	ALWAYS_INLINE void store(double* const p, const V& v) {
+		memcpy(p, &v, sizeof(V));
+	}
+
+	/*
+	 * sin(x) = (-1)^k * sin(r), where k = round(x / pi), r = x - k * pi.
+	 * pi is split into four parts so that k * PI_A, k * PI_B, k * PI_C are
+	 * exact for |k| < 2^24, r is in [-pi/2, pi/2] and sin(r) is evaluated
+	 * by Taylor polynomial up to r^21 (truncation error is below 1.3e-18).
+	 * x is replaced by the result.
+	 */
+	template <typename V, typename I>
+	ALWAYS_INLINE void vectorSin(V& x) {
+		const double invPi = 0.318309886183790671537767526745;
+		const double piA = 3.1415926218032836914;
+		const double piB = 3.1786509424591713469e-08;
+		const double piC = 1.2246467864107188502e-16;
+		const double piD = 1.2736634327021899816e-24;
+		const double magic = 6755399441055744.0;	// 1.5 * 2^52
+
+		// round to nearest, the low bit of q holds parity of k
+		const V q = x * invPi + magic;
+		const V k = q - magic;
+
+		V r = x - k * piA;
+		r = r - k * piB;
+		r = r - k * piC;
+		r = r - k * piD;
+
+		const V r2 = r * r;
+		V p = r2 * (1.0 / 51090942171709440000.0) - (1.0 / 121645100408832000.0);
+		p = p * r2 + (1.0 / 355687428096000.0);
+		p = p * r2 - (1.0 / 1307674368000.0);
+		p = p * r2 + (1.0 / 6227020800.0);
+		p = p * r2 - (1.0 / 39916800.0);
+		p = p * r2 + (1.0 / 362880.0);
+		p = p * r2 - (1.0 / 5040.0);
+		p = p * r2 + (1.0 / 120.0);
+		p = p * r2 - (1.0 / 6.0);
+		const V s = r + r * r2 * p;
+
+		// negate result if k is odd
+		x = (V) ((I) s ^ ((I) q << 63));
+	}
+
+	template <typename V, typename I>
+	ALWAYS_INLINE void vectorStep(
+			std::size_t const i,
+			const double* const phi,
+			const double* const u,
+			const double* const drive,
+			const double* const invBeta,
+			const double* const tauBeta,
+			const double* const vBeta,
+			double* const du) {
+
+		V sn, vu, vdrive, vinvBeta, vtauBeta, vvBeta;
+		load(sn, phi + i);
+		load(vu, u + i);
+		load(vdrive, drive + i);
+		load(vinvBeta, invBeta + i);
+		load(vtauBeta, tauBeta + i);
+		load(vvBeta, vBeta + i);
+
+		vectorSin<V, I>(sn);
+		store(du + i, vinvBeta * vdrive - vtauBeta * vu - vvBeta * sn);
+	}
+
+	template <typename V, typename I, std::size_t W>
+	ALWAYS_INLINE void vectorKernel(
+			std::size_t const n,
+			const double* const phi,
+			const double* const u,
+			const double* const drive,
+			const double* const invBeta,
+			const double* const tauBeta,
+			const double* const vBeta,
+			double* const du) {
+
+		const std::size_t body = n - n % W;
+		for (std::size_t i = 0; i < body; i += W) {
+			vectorStep<V, I>(i, phi, u, drive, invBeta, tauBeta, vBeta, du);
+		}
+
+		if (body < n) {
+			// tail is padded with neutral values
+			double tphi[W], tu[W], tdrive[W], tinvBeta[W], ttauBeta[W], tvBeta[W], tdu[W];
+			const std::size_t tail = n - body;
+			for (std::size_t j = 0; j < W; ++j) {
+				const bool valid = j < tail;
+				tphi[j] = valid ? phi[body + j] : 0.0;
+				tu[j] = valid ? u[body + j] : 0.0;
+				tdrive[j] = valid ? drive[body + j] : 0.0;
+				tinvBeta[j] = valid ? invBeta[body + j] : 0.0;
+				ttauBeta[j] = valid ? tauBeta[body + j] : 0.0;
+				tvBeta[j] = valid ? vBeta[body + j] : 0.0;
+			}
+			vectorStep<V, I>(0, tphi, tu, tdrive, tinvBeta, ttauBeta, tvBeta, tdu);
+			memcpy(du + body, tdu, tail * sizeof(double));
+		}
+	}
+
+	void sse2Kernel(
+			std::size_t const n,
+			const double* const phi,
+			const double* const u,
+			const double* const drive,
+			const double* const invBeta,
+			const double* const tauBeta,
+			const double* const vBeta,
+			double* const du) {
+
+		vectorKernel<v2df, v2di, 2>(n, phi, u, drive, invBeta, tauBeta, vBeta, du);
+	}
+
+	__attribute__((target("avx2,fma")))
+	void avx2Kernel(
+			std::size_t const n,
+			const double* const phi,
+			const double* const u,
+			const double* const drive,
+			const double* const invBeta,
+			const double* const tauBeta,
+			const double* const vBeta,
+			double* const du) {
+
+		vectorKernel<v4df, v4di, 4>(n, phi, u, drive, invBeta, tauBeta, vBeta, du);
+	}
+
+	__attribute__((target("avx512f")))
+	void avx512Kernel(
+			std::size_t const n,
+			const double* const phi,
+			const double* const u,
+			const double* const drive,
+			const double* const invBeta,
+			const double* const tauBeta,
+			const double* const vBeta,
+			double* const du) {
+
+		vectorKernel<v8df, v8di, 8>(n, phi, u, drive, invBeta, tauBeta, vBeta, du);
+	}
+
+#endif	// CONTACT_KERNEL_X86
+
+	ContactKernel::Function findFunction(const std::string& name) {
+		if ("scalar" == name) {
+			return scalarKernel;
+		}
+
+#ifdef CONTACT_KERNEL_X86
+		__builtin_cpu_init();
+
+		if ("sse2" == name && __builtin_cpu_supports("sse2")) {
+			return sse2Kernel;
+		}
+
+		if ("avx2" == name && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+			return avx2Kernel;
+		}
+
+		if ("avx512" == name && __builtin_cpu_supports("avx512f")) {
+			return avx512Kernel;
+		}
+#endif
+
+		return 0;
+	}
+
+	std::string detectBest() {
+		const char* const candidates[] = {"avx512", "avx2", "sse2"};
+
+		for (std::size_t i = 0; i < sizeof(candidates) / sizeof(*candidates); ++i) {
+			if (findFunction(candidates[i])) {
+				return candidates[i];
+			}
+		}
+
+		return "scalar";
+	}
+
+}
+
+ContactKernel::ContactKernel(const std::string& name) :
+	name("auto" == name ? detectBest() : name),
+	function(findFunction(this->name)) {
+
+	if (!function) {
+		throw UnknownKernel(name);
+	}
+}
+
+bool ContactKernel::isSupported(const std::string& name) {
+	return "auto" == name || findFunction(name) != 0;
+}
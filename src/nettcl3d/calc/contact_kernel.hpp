@@ -0,0 +1,82 @@
+/*
+ * calc/contact_kernel.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_CONTACT_KERNEL_HPP_
+#define CALC_CONTACT_KERNEL_HPP_
+
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+
+/*
+ * Vectorized evaluation of contact voltage derivatives:
+ * du[i] = invBeta[i] * drive[i] - tauBeta[i] * u[i] - vBeta[i] * sin(phi[i])
+ * where invBeta = 1 / beta, tauBeta = tau / beta and vBeta = v / beta are
+ * precomputed by caller.
+ *
+ * Several implementations exist (scalar, SSE2, AVX2, AVX-512), the best one
+ * supported by CPU is selected at runtime. Vector implementations use
+ * polynomial approximation of sine with absolute error below 1e-15 after
+ * range reduction.
+ */
+class ContactKernel {
+public:
+
+	typedef void (*Function)(
+			std::size_t n,
+			const double* phi,
+			const double* u,
+			const double* drive,
+			const double* invBeta,
+			const double* tauBeta,
+			const double* vBeta,
+			double* du);
+
+	struct UnknownKernel : public std::invalid_argument {
+
+		UnknownKernel(const std::string& name) : std::invalid_argument("unknown or unsupported kernel: " + name) {}
+
+	};
+
+	/*
+	 * Selects implementation by name: auto, scalar, sse2, avx2 or avx512.
+	 * "auto" stands for the best implementation supported by CPU.
+	 */
+	explicit ContactKernel(const std::string& name = "auto");
+
+	void operator()(
+			std::size_t const n,
+			const double* const phi,
+			const double* const u,
+			const double* const drive,
+			const double* const invBeta,
+			const double* const tauBeta,
+			const double* const vBeta,
+			double* const du) const {
+		function(n, phi, u, drive, invBeta, tauBeta, vBeta, du);
+	}
+
+	const std::string& getName() const {
+		return name;
+	}
+
+	static bool isSupported(const std::string& name);
+
+private:
+
+	std::string name;
+	Function function;
+
+};
+
+#endif /* CALC_CONTACT_KERNEL_HPP_ */
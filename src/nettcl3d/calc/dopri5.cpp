@@ -0,0 +1,213 @@
+/*
+ * calc/dopri5.cpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include <string.h>
+#include <vector>
+#include <gsl/gsl_errno.h>
+#include "dopri5.hpp"
+#include "step_point.hpp"
+
+namespace {
+
+	// Butcher tableau
+	const double c2 = 1.0 / 5.0, c3 = 3.0 / 10.0, c4 = 4.0 / 5.0, c5 = 8.0 / 9.0;
+
+	const double a21 = 1.0 / 5.0;
+	const double a31 = 3.0 / 40.0, a32 = 9.0 / 40.0;
+	const double a41 = 44.0 / 45.0, a42 = -56.0 / 15.0, a43 = 32.0 / 9.0;
+	const double a51 = 19372.0 / 6561.0, a52 = -25360.0 / 2187.0, a53 = 64448.0 / 6561.0, a54 = -212.0 / 729.0;
+	const double a61 = 9017.0 / 3168.0, a62 = -355.0 / 33.0, a63 = 46732.0 / 5247.0, a64 = 49.0 / 176.0, a65 = -5103.0 / 18656.0;
+	const double a71 = 35.0 / 384.0, a73 = 500.0 / 1113.0, a74 = 125.0 / 192.0, a75 = -2187.0 / 6784.0, a76 = 11.0 / 84.0;
+
+	// difference between 5th and 4th order solutions
+	const double e1 = 71.0 / 57600.0, e3 = -71.0 / 16695.0, e4 = 71.0 / 1920.0, e5 = -17253.0 / 339200.0, e6 = 22.0 / 525.0, e7 = -1.0 / 40.0;
+
+	// dense output
+	const double d1 = -12715105075.0 / 11282082432.0, d3 = 87487479700.0 / 32700410799.0, d4 = -10690763975.0 / 1880347072.0;
+	const double d5 = 701980252875.0 / 199316789632.0, d6 = -1453857185.0 / 822651844.0, d7 = 69997945.0 / 29380423.0;
+
+	struct State {
+
+		std::vector<double> k1, k2, k3, k4, k5, k6, k7, ytmp;
+
+		// start and end of the last step, the end is the start of the next
+		// step if it is accepted, the start is used again if it is rejected
+		StepPoint start, end;
+
+		explicit State(std::size_t const dim) :
+			k1(dim), k2(dim), k3(dim), k4(dim), k5(dim), k6(dim), k7(dim), ytmp(dim),
+			start(dim), end(dim) {}
+
+	};
+
+	void* dopri5Alloc(size_t const dim) {
+		try {
+			return new State(dim);
+		} catch (...) {
+			return 0;
+		}
+	}
+
+	int dopri5Apply(
+			void* const vstate,
+			size_t const dim,
+			double const t,
+			double const h,
+			double y[],
+			double yerr[],
+			const double dydt_in[],
+			double dydt_out[],
+			const gsl_odeiv2_system* const sys) {
+
+		State& s = *static_cast<State*>(vstate);
+		double* const k1 = &s.k1[0];
+		double* const k2 = &s.k2[0];
+		double* const k3 = &s.k3[0];
+		double* const k4 = &s.k4[0];
+		double* const k5 = &s.k5[0];
+		double* const k6 = &s.k6[0];
+		double* const k7 = &s.k7[0];
+		double* const ytmp = &s.ytmp[0];
+
+		int status = GSL_SUCCESS;
+
+		if (dydt_in) {
+			memcpy(k1, dydt_in, dim * sizeof(double));
+		} else if (s.end.matches(t, y)) {
+			memcpy(k1, &s.end.dydt[0], dim * sizeof(double));
+		} else if (s.start.matches(t, y)) {
+			memcpy(k1, &s.start.dydt[0], dim * sizeof(double));
+		} else {
+			status = GSL_ODEIV_FN_EVAL(sys, t, y, k1);
+		}
+
+		if (GSL_SUCCESS != status) {
+			return status;
+		}
+
+		s.start.assign(t, y, k1);
+		s.end.valid = false;
+
+		for (size_t i = 0; i < dim; ++i) {
+			ytmp[i] = y[i] + h * a21 * k1[i];
+		}
+		status = GSL_ODEIV_FN_EVAL(sys, t + c2 * h, ytmp, k2);
+
+		if (GSL_SUCCESS == status) {
+			for (size_t i = 0; i < dim; ++i) {
+				ytmp[i] = y[i] + h * (a31 * k1[i] + a32 * k2[i]);
+			}
+			status = GSL_ODEIV_FN_EVAL(sys, t + c3 * h, ytmp, k3);
+		}
+
+		if (GSL_SUCCESS == status) {
+			for (size_t i = 0; i < dim; ++i) {
+				ytmp[i] = y[i] + h * (a41 * k1[i] + a42 * k2[i] + a43 * k3[i]);
+			}
+			status = GSL_ODEIV_FN_EVAL(sys, t + c4 * h, ytmp, k4);
+		}
+
+		if (GSL_SUCCESS == status) {
+			for (size_t i = 0; i < dim; ++i) {
+				ytmp[i] = y[i] + h * (a51 * k1[i] + a52 * k2[i] + a53 * k3[i] + a54 * k4[i]);
+			}
+			status = GSL_ODEIV_FN_EVAL(sys, t + c5 * h, ytmp, k5);
+		}
+
+		if (GSL_SUCCESS == status) {
+			for (size_t i = 0; i < dim; ++i) {
+				ytmp[i] = y[i] + h * (a61 * k1[i] + a62 * k2[i] + a63 * k3[i] + a64 * k4[i] + a65 * k5[i]);
+			}
+			status = GSL_ODEIV_FN_EVAL(sys, t + h, ytmp, k6);
+		}
+
+		if (GSL_SUCCESS == status) {
+			for (size_t i = 0; i < dim; ++i) {
+				y[i] += h * (a71 * k1[i] + a73 * k3[i] + a74 * k4[i] + a75 * k5[i] + a76 * k6[i]);
+			}
+			status = GSL_ODEIV_FN_EVAL(sys, t + h, y, k7);
+		}
+
+		if (GSL_SUCCESS != status) {
+			memcpy(y, &s.start.y[0], dim * sizeof(double));
+			return status;
+		}
+
+		for (size_t i = 0; i < dim; ++i) {
+			yerr[i] = h * (e1 * k1[i] + e3 * k3[i] + e4 * k4[i] + e5 * k5[i] + e6 * k6[i] + e7 * k7[i]);
+		}
+
+		if (dydt_out) {
+			memcpy(dydt_out, k7, dim * sizeof(double));
+		}
+
+		s.end.assign(t + h, y, k7);
+
+		return GSL_SUCCESS;
+	}
+
+	int dopri5SetDriver(void* /* vstate */, const gsl_odeiv2_driver* /* d */) {
+		return GSL_SUCCESS;
+	}
+
+	int dopri5Reset(void* const vstate, size_t /* dim */) {
+		State& s = *static_cast<State*>(vstate);
+		s.start.valid = false;
+		s.end.valid = false;
+		return GSL_SUCCESS;
+	}
+
+	unsigned int dopri5Order(void* /* vstate */) {
+		return 5;
+	}
+
+	void dopri5Free(void* const vstate) {
+		delete static_cast<State*>(vstate);
+	}
+
+	const gsl_odeiv2_step_type dopri5Type = {
+		"dopri5",
+		0,	// first stage is cached by the method itself, see above
+		1,	// gives exact dydt_out
+		&dopri5Alloc,
+		&dopri5Apply,
+		&dopri5SetDriver,
+		&dopri5Reset,
+		&dopri5Order,
+		&dopri5Free
+	};
+
+}
+
+const gsl_odeiv2_step_type* const dopri5StepType = &dopri5Type;
+
+bool dopri5Interpolate(const gsl_odeiv2_step* const step, double const t, double y[]) {
+	const State& s = *static_cast<const State*>(step->state);
+	if (!s.start.valid || !s.end.valid) {
+		return false;
+	}
+
+	const double h = s.end.t - s.start.t;
+	const double theta = (t - s.start.t) / h, theta1 = 1.0 - theta;
+
+	for (std::size_t i = 0, n = s.ytmp.size(); i < n; ++i) {
+		const double y0 = s.start.y[i];
+		const double r2 = s.end.y[i] - y0;
+		const double r3 = h * s.k1[i] - r2;
+		const double r4 = r2 - h * s.k7[i] - r3;
+		const double r5 = h * (d1 * s.k1[i] + d3 * s.k3[i] + d4 * s.k4[i] + d5 * s.k5[i] + d6 * s.k6[i] + d7 * s.k7[i]);
+		y[i] = y0 + theta * (r2 + theta1 * (r3 + theta * (r4 + theta1 * r5)));
+	}
+
+	return true;
+}
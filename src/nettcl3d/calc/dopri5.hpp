@@ -0,0 +1,36 @@
+/*
+ * calc/dopri5.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_DOPRI5_HPP_
+#define CALC_DOPRI5_HPP_
+
+#include <gsl/gsl_odeiv2.h>
+
+/*
+ * Dormand-Prince 5(4) explicit Runge-Kutta method.
+ * The last stage is evaluated at the new point (FSAL). GSL evolve does not
+ * pass it back to the next step, so the method keeps it along with the
+ * point and reuses it as the first stage when the next step starts there:
+ * an accepted step costs six RHS evaluations.
+ */
+extern const gsl_odeiv2_step_type* const dopri5StepType;
+
+/*
+ * Continuous extension of the last step taken by step of dopri5StepType
+ * (Hairer, Norsett, Wanner, Solving ODE I, II.6): writes state at time t
+ * within the step to y, fourth order accurate at no extra RHS evaluation.
+ * Returns false if the step has been reset since.
+ */
+bool dopri5Interpolate(const gsl_odeiv2_step* step, double t, double y[]);
+
+#endif /* CALC_DOPRI5_HPP_ */
@@ -0,0 +1,279 @@
+/*
+ * calc/event_detector.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_EVENT_DETECTOR_HPP_
+#define CALC_EVENT_DETECTOR_HPP_
+
+#include <math.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "network.hpp"
+#include "incidence.hpp"
+
+/*
+ * Detects events within integration steps:
+ *   phase slip  - phase of a contact crosses an odd multiple of pi,
+ *   flux entry  - flux of a circuit crosses a half-integer number of quanta.
+ * Every accepted step is checked by comparing values at its ends, the
+ * time of crossing is found by bisection of cubic Hermite interpolant built
+ * from values and derivatives at the ends of the step (derivative of phase
+ * is voltage, so the state vector holds both).
+ *
+ * Events are passed to listener or written to log file if any of them is
+ * given, otherwise they are kept until retrieved by getEvents().
+ */
+class EventDetector {
+public:
+
+	typedef enum {PHASE_SLIP, FLUX_ENTRY} Type;
+
+	struct Event {
+		Type type;
+		double time;
+		std::size_t network;	// index in ensemble
+		std::size_t index;	// of contact or circuit
+		int direction;	// 1 if value increases, -1 otherwise
+
+		bool operator<(const Event& other) const {
+			return time < other.time;
+		}
+	};
+
+	typedef std::vector<Event> EventVector;
+
+	struct Listener {
+
+		virtual ~Listener() {}
+
+		virtual void onEvent(const Event& event) = 0;
+
+	};
+
+	struct Params {
+		bool phaseSlips, fluxEntries;
+		std::string fileName;
+		Listener* listener;
+
+		Params() : phaseSlips(true), fluxEntries(true), listener(0) {}
+	};
+
+	EventDetector(const Params& params) : params(params), incidence(0), numOfLanes(1), haveEnd(false), endTime(0.0) {
+		if (!params.fileName.empty()) {
+			log.open(params.fileName.c_str(), std::ios::out | std::ios::trunc);
+			if (!log) {
+				throw std::runtime_error("cannot create file " + params.fileName);
+			}
+			log << "# time\ttype\tnetwork\tindex\tdirection\n";
+		}
+	}
+
+	const Params& getParams() const {
+		return params;
+	}
+
+	static const char* typeName(Type const type) {
+		return PHASE_SLIP == type ? "phase-slip" : "flux-entry";
+	}
+
+	/*
+	 * Values of state vectors are laid out as in RhsKernel.
+	 */
+	void setup(const Incidence& incidence, std::size_t const numOfLanes) {
+		this->incidence = &incidence;
+		this->numOfLanes = numOfLanes;
+
+		const std::size_t size = incidence.getNumOfCircuits() * numOfLanes;
+		windingFluxes.assign(size, 0.0);
+		startFluxes.resize(size);
+		startRates.resize(size);
+		endFluxes.resize(size);
+		endRates.resize(size);
+		haveEnd = false;
+	}
+
+	/*
+	 * Sets number of whole turns of phases, see RhsKernel::setWindings().
+	 */
+	void setWindings(const long* const windings) {
+		if (!params.fluxEntries || windingFluxes.empty()) {
+			return;
+		}
+
+		const std::size_t n = incidence->getNumOfContacts() * numOfLanes;
+		Network::ValueVector turns(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			turns[i] = windings[i];
+		}
+
+		// flux of whole turns is square * sum(weight * 2 pi turns) / 2 pi
+		incidence->circuitPhases(&turns[0], &windingFluxes[0], 0, incidence->getNumOfCircuits(), numOfLanes);
+
+		// phases of the state changed, so do fluxes computed from them
+		haveEnd = false;
+	}
+
+	/*
+	 * Checks step from t0 to t1, y0 and y1 are state vectors at its ends.
+	 * Fluxes at the end of a step are kept as those at the start of the
+	 * next one, until windings change.
+	 */
+	void check(double const t0, const double* const y0, double const t1, const double* const y1) {
+		const static double pi = 3.1415926535897932384626433832795;
+		const static double twoPi = 2.0 * pi;
+
+		const std::size_t n = incidence->getNumOfContacts() * numOfLanes;
+		const double h = t1 - t0;
+		stepEvents.clear();
+
+		if (params.phaseSlips) {
+			for (std::size_t j = 0; j < n; ++j) {
+				const double b0 = floor((y0[j] + pi) / twoPi);
+				const double b1 = floor((y1[j] + pi) / twoPi);
+				if (b0 != b1) {
+					crossings(PHASE_SLIP, j, t0, h, y0[j], y1[j], y0[n + j], y1[n + j], b0, b1, twoPi, -pi);
+				}
+			}
+		}
+
+		if (params.fluxEntries && !windingFluxes.empty()) {
+			if (haveEnd && t0 == endTime) {
+				startFluxes.swap(endFluxes);
+				startRates.swap(endRates);
+			} else {
+				fluxes(y0, n, startFluxes, startRates);
+			}
+			fluxes(y1, n, endFluxes, endRates);
+			haveEnd = true;
+			endTime = t1;
+
+			for (std::size_t j = 0, m = windingFluxes.size(); j < m; ++j) {
+				const double b0 = floor(startFluxes[j] + 0.5);
+				const double b1 = floor(endFluxes[j] + 0.5);
+				if (b0 != b1) {
+					crossings(FLUX_ENTRY, j, t0, h, startFluxes[j], endFluxes[j], startRates[j], endRates[j], b0, b1, 1.0, -0.5);
+				}
+			}
+		}
+
+		std::stable_sort(stepEvents.begin(), stepEvents.end());
+		for (EventVector::const_iterator i = stepEvents.begin(), last = stepEvents.end(); i != last; ++i) {
+			report(*i);
+		}
+	}
+
+	const EventVector& getEvents() const {
+		return events;
+	}
+
+	void clearEvents() {
+		events.clear();
+	}
+
+private:
+
+	const Params params;
+	std::ofstream log;
+	const Incidence* incidence;
+	std::size_t numOfLanes;
+	EventVector events, stepEvents;
+
+	// fluxes of circuits in quanta and their rates at ends of step
+	Network::ValueVector windingFluxes;
+	Network::ValueVector startFluxes, startRates, endFluxes, endRates;
+	bool haveEnd;	// end values are those of the state y0 of the next step at endTime
+	double endTime;
+
+	void fluxes(const double* const y, std::size_t const n, Network::ValueVector& flux, Network::ValueVector& rate) const {
+		const static double invTwoPi = 1.0 / (2.0 * 3.1415926535897932384626433832795);
+
+		const std::size_t numOfCircuits = incidence->getNumOfCircuits();
+		incidence->circuitPhases(y, &flux[0], 0, numOfCircuits, numOfLanes);
+		incidence->circuitPhases(y + n, &rate[0], 0, numOfCircuits, numOfLanes);
+		for (std::size_t j = 0, m = flux.size(); j < m; ++j) {
+			flux[j] = flux[j] * invTwoPi + windingFluxes[j];
+			rate[j] *= invTwoPi;
+		}
+	}
+
+	/*
+	 * Value crosses levels period * b + offset for b from min(b0, b1) + 1
+	 * to max(b0, b1), where b0 and b1 are bins of values at ends of step.
+	 */
+	void crossings(
+			Type const type,
+			std::size_t const slot,
+			double const t0,
+			double const h,
+			double const v0,
+			double const v1,
+			double const d0,
+			double const d1,
+			double const b0,
+			double const b1,
+			double const period,
+			double const offset) {
+
+		const int direction = b1 > b0 ? 1 : -1;
+		for (double b = std::min(b0, b1) + 1.0; b <= std::max(b0, b1); b += 1.0) {
+			Event e;
+			e.type = type;
+			e.time = t0 + h * root(v0, v1, d0 * h, d1 * h, period * b + offset);
+			e.network = slot % numOfLanes;
+			e.index = slot / numOfLanes;
+			e.direction = direction;
+			stepEvents.push_back(e);
+		}
+	}
+
+	// root of Hermite interpolant minus level on [0, 1], derivatives are scaled by step size
+	static double root(double const v0, double const v1, double const d0, double const d1, double const level) {
+		const bool increasing = v1 > v0;
+		double a = 0.0, b = 1.0;
+
+		for (int i = 0; i < 52; ++i) {
+			const double s = 0.5 * (a + b);
+			const double s2 = s * s, s3 = s2 * s;
+			const double v = (2.0 * s3 - 3.0 * s2 + 1.0) * v0 + (s3 - 2.0 * s2 + s) * d0
+				+ (-2.0 * s3 + 3.0 * s2) * v1 + (s3 - s2) * d1;
+			if ((v < level) == increasing) {
+				a = s;
+			} else {
+				b = s;
+			}
+		}
+
+		return 0.5 * (a + b);
+	}
+
+	void report(const Event& e) {
+		if (params.listener) {
+			params.listener->onEvent(e);
+		}
+
+		if (log.is_open()) {
+			log << std::setprecision(15) << e.time << '\t' << typeName(e.type) << '\t'
+				<< e.network << '\t' << e.index << '\t' << e.direction << '\n';
+		}
+
+		if (!params.listener && !log.is_open()) {
+			events.push_back(e);
+		}
+	}
+
+};
+
+#endif /* CALC_EVENT_DETECTOR_HPP_ */
@@ -0,0 +1,98 @@
+/*
+ * calc/field_drive.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_FIELD_DRIVE_HPP_
+#define CALC_FIELD_DRIVE_HPP_
+
+#include <math.h>
+#include <stdexcept>
+#include <string>
+#include "point.hpp"
+
+/*
+ * Time-dependent field added to static field of selected contacts during
+ * integration: h(t) = h + amplitude * waveform(t).
+ *   AC:    sin(2 pi frequency (t - start) + phase) after start
+ *   RAMP:  rises linearly from 0 at start to 1 at start + duration
+ *   PULSE: 1 for duration after start, repeated with given frequency
+ *          (0 means single pulse)
+ * Waveform is 0 before start.
+ */
+class FieldDrive {
+public:
+
+	typedef enum {AC, RAMP, PULSE} Shape;
+
+	struct Params {
+		Shape shape;
+		Point amplitude;
+		double frequency;
+		double phase;
+		double start;
+		double duration;
+		std::string tagExpr;
+
+		Params(Shape const shape, const Point& amplitude) :
+			shape(shape), amplitude(amplitude), frequency(0.0), phase(0.0), start(0.0), duration(0.0) {}
+	};
+
+	FieldDrive(const Params& params) : params(params) {
+		if (params.frequency < 0.0) {
+			throw std::invalid_argument("frequency must not be negative");
+		}
+
+		if (params.duration < 0.0) {
+			throw std::invalid_argument("duration must not be negative");
+		}
+
+		if (PULSE == params.shape && params.frequency * params.duration > 1.0) {
+			throw std::invalid_argument("pulses overlap");
+		}
+	}
+
+	const Params& getParams() const {
+		return params;
+	}
+
+	double waveform(double const time) const {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+
+		const double t = time - params.start;
+		if (t < 0.0) {
+			return 0.0;
+		}
+
+		switch (params.shape) {
+		case AC:
+			return sin(twoPi * params.frequency * t + params.phase);
+
+		case RAMP:
+			return t < params.duration ? t / params.duration : 1.0;
+
+		case PULSE:
+			if (params.frequency > 0.0) {
+				return fmod(t, 1.0 / params.frequency) < params.duration ? 1.0 : 0.0;
+			}
+			return t < params.duration ? 1.0 : 0.0;
+		}
+
+		return 0.0;
+	}
+
+private:
+
+	const Params params;
+
+};
+
+#endif /* CALC_FIELD_DRIVE_HPP_ */
@@ -0,0 +1,169 @@
+/*
+ * calc/imex.cpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include <string.h>
+#include <vector>
+#include <gsl/gsl_errno.h>
+#include "imex.hpp"
+#include "step_point.hpp"
+
+namespace {
+
+	const double gamma = 1.0 - 0.70710678118654752440;
+	const double delta = 1.0 - 1.0 / (2.0 * gamma);
+
+	/*
+	 * (I - gamma h A) Y2 = y + gamma h N(y)
+	 * (I - gamma h A) Y3 = y + h (delta N(y) + (1 - delta) N(Y2)) + (1 - gamma) h A Y2
+	 * y' = Y3
+	 * embedded solution is y + (Y2 - y) / gamma, that is y + h (N(y) + A Y2)
+	 * derivative at the end is N(Y3) + A Y3, where A Y3 = (Y3 - r3) / (gamma h)
+	 * follows from the last stage, and N(Y3) starts the next step
+	 */
+	struct State : public ImplicitStepState {
+
+		std::vector<double> n1, n2, r, y2, y3;
+
+		// start and end of the last step, with nonlinear part in place of derivative
+		StepPoint start, end;
+
+		explicit State(std::size_t const dim) : n1(dim), n2(dim), r(dim), y2(dim), y3(dim), start(dim), end(dim) {}
+
+	};
+
+	State& state(void* const vstate) {
+		return *static_cast<State*>(static_cast<ImplicitStepState*>(vstate));
+	}
+
+	void* imexAlloc(size_t const dim) {
+		try {
+			return static_cast<ImplicitStepState*>(new State(dim));
+		} catch (...) {
+			return 0;
+		}
+	}
+
+	int imexApply(
+			void* const vstate,
+			size_t const dim,
+			double const t,
+			double const h,
+			double y[],
+			double yerr[],
+			const double /* dydt_in */[],
+			double dydt_out[],
+			const gsl_odeiv2_system* /* sys */) {
+
+		State& s = state(vstate);
+		if (!s.system) {
+			return GSL_EINVAL;
+		}
+
+		double* const n1 = &s.n1[0];
+		double* const n2 = &s.n2[0];
+		double* const r = &s.r[0];
+		double* const y2 = &s.y2[0];
+		double* const y3 = &s.y3[0];
+		const double a = gamma * h;
+
+		int status = GSL_SUCCESS;
+		if (s.end.matches(t, y)) {
+			memcpy(n1, &s.end.dydt[0], dim * sizeof(double));
+		} else if (s.start.matches(t, y)) {
+			memcpy(n1, &s.start.dydt[0], dim * sizeof(double));
+		} else {
+			status = s.system->evaluateNonlinear(t, y, n1);
+		}
+
+		if (GSL_SUCCESS != status) {
+			return status;
+		}
+
+		s.start.assign(t, y, n1);
+		s.end.valid = false;
+
+		for (size_t i = 0; i < dim; ++i) {
+			r[i] = y[i] + a * n1[i];
+		}
+		status = s.system->solveLinear(a, r, y2);
+
+		if (GSL_SUCCESS == status) {
+			status = s.system->evaluateNonlinear(t + a, y2, n2);
+		}
+
+		if (GSL_SUCCESS == status) {
+			// A Y2 = (Y2 - r) / a
+			for (size_t i = 0; i < dim; ++i) {
+				r[i] = y[i] + h * (delta * n1[i] + (1.0 - delta) * n2[i]) + (1.0 - gamma) / gamma * (y2[i] - r[i]);
+			}
+			status = s.system->solveLinear(a, r, y3);
+		}
+
+		// nonlinear part at the end is needed by the next step anyway
+		if (GSL_SUCCESS == status) {
+			status = s.system->evaluateNonlinear(t + h, y3, n2);
+		}
+
+		if (GSL_SUCCESS != status) {
+			return status;
+		}
+
+		for (size_t i = 0; i < dim; ++i) {
+			yerr[i] = y3[i] - y[i] - (y2[i] - y[i]) / gamma;
+		}
+
+		if (dydt_out) {
+			for (size_t i = 0; i < dim; ++i) {
+				dydt_out[i] = n2[i] + (y3[i] - r[i]) / a;
+			}
+		}
+
+		memcpy(y, y3, dim * sizeof(double));
+		s.end.assign(t + h, y, n2);
+		return GSL_SUCCESS;
+	}
+
+	int imexSetDriver(void* /* vstate */, const gsl_odeiv2_driver* /* d */) {
+		return GSL_SUCCESS;
+	}
+
+	int imexReset(void* const vstate, size_t /* dim */) {
+		State& s = state(vstate);
+		s.start.valid = false;
+		s.end.valid = false;
+		return GSL_SUCCESS;
+	}
+
+	unsigned int imexOrder(void* /* vstate */) {
+		return 2;
+	}
+
+	void imexFree(void* const vstate) {
+		delete &state(vstate);
+	}
+
+	const gsl_odeiv2_step_type imexType = {
+		"imex",
+		0,	// nonlinear part at the start is cached by the method itself
+		1,	// gives exact dydt_out, up to tolerance of the linear solver
+		&imexAlloc,
+		&imexApply,
+		&imexSetDriver,
+		&imexReset,
+		&imexOrder,
+		&imexFree
+	};
+
+}
+
+const gsl_odeiv2_step_type* const imexStepType = &imexType;
@@ -0,0 +1,30 @@
+/*
+ * calc/imex.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_IMEX_HPP_
+#define CALC_IMEX_HPP_
+
+#include <gsl/gsl_odeiv2.h>
+#include "implicit_system.hpp"
+
+/*
+ * Implicit-explicit Runge-Kutta method ARS(2,2,2) (Ascher, Ruuth,
+ * Spiteri, 1997). Linear part of the system f = A y + N(y) is treated by
+ * L-stable SDIRK, the nonlinear part explicitly, so the step is not
+ * limited by stiffness of A. Error is estimated against embedded first
+ * order solution. ImplicitSystem must be attached to the step by
+ * setImplicitSystem() before use.
+ */
+extern const gsl_odeiv2_step_type* const imexStepType;
+
+#endif /* CALC_IMEX_HPP_ */
@@ -0,0 +1,64 @@
+/*
+ * calc/implicit_system.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_IMPLICIT_SYSTEM_HPP_
+#define CALC_IMPLICIT_SYSTEM_HPP_
+
+#include <gsl/gsl_odeiv2.h>
+
+/*
+ * Operations needed by implicit and IMEX methods in addition to the RHS.
+ * Implementations exploit the structure of the system instead of forming
+ * its Jacobian explicitly. All methods return GSL status, GSL_FAILURE if
+ * a linear system could not be solved.
+ */
+class ImplicitSystem {
+public:
+
+	virtual ~ImplicitSystem() {}
+
+	/*
+	 * Solves (I - a * J(t, y)) * k = r, where J is Jacobian of the system.
+	 */
+	virtual int solve(double t, const double y[], double a, const double r[], double k[]) = 0;
+
+	/*
+	 * The system is split as f(t, y) = A * y + N(t, y) where A is constant
+	 * linear operator. Calculates N(t, y).
+	 */
+	virtual int evaluateNonlinear(double t, const double y[], double f[]) = 0;
+
+	/*
+	 * Solves (I - a * A) * k = r.
+	 */
+	virtual int solveLinear(double a, const double r[], double k[]) = 0;
+
+};
+
+/*
+ * State of every implicit step type starts with this structure, so that
+ * the system can be attached to an allocated step.
+ */
+struct ImplicitStepState {
+
+	ImplicitSystem* system;
+
+	ImplicitStepState() : system(0) {}
+
+};
+
+inline void setImplicitSystem(gsl_odeiv2_step* const step, ImplicitSystem* const system) {
+	static_cast<ImplicitStepState*>(step->state)->system = system;
+}
+
+#endif /* CALC_IMPLICIT_SYSTEM_HPP_ */
@@ -0,0 +1,229 @@
+/*
+ * calc/incidence.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_INCIDENCE_HPP_
+#define CALC_INCIDENCE_HPP_
+
+#include <vector>
+#include "network.hpp"
+
+/*
+ * Contact-circuit incidence matrix in compressed sparse row (CSR) form.
+ * Two matrices are kept: circuit rows with contact weights (used to
+ * calculate circuit phases) and contact rows with circuit gains (used to
+ * calculate circuit feedback on contacts).
+ */
+class Incidence {
+public:
+
+	typedef unsigned column_type;
+	typedef std::vector<std::size_t> RowVector;
+	typedef std::vector<column_type> ColumnVector;
+	typedef std::vector<double> ValueVector;
+
+	Incidence() : numOfContacts(0) {}
+
+	void build(const Network& network) {
+		const std::size_t numOfCircuits = network.getNumOfCircuits();
+		numOfContacts = network.getNumOfContacts();
+
+		circuitRows.assign(1, 0);
+		circuitCols.clear();
+		circuitWeights.clear();
+		squares.clear();
+		circuitRows.reserve(numOfCircuits + 1);
+		squares.reserve(numOfCircuits);
+
+		contactRows.assign(numOfContacts + 1, 0);
+
+		// circuit rows, also count number of circuits per contact
+		for (Network::circuit_const_iterator circuit = network.circuitBegin(), end = network.circuitEnd(); circuit != end; ++circuit) {
+			for (Circuit::const_iterator ci = circuit->begin(), last = circuit->end(); ci != last; ++ci) {
+				circuitCols.push_back(static_cast<column_type>(ci->index));
+				circuitWeights.push_back(ci->weight);
+				++contactRows[ci->index + 1];
+			}
+			circuitRows.push_back(circuitCols.size());
+			squares.push_back(circuit->square);
+		}
+
+		// contact rows
+		for (std::size_t i = 0; i < numOfContacts; ++i) {
+			contactRows[i + 1] += contactRows[i];
+		}
+
+		contactCols.resize(contactRows[numOfContacts]);
+		contactGains.resize(contactRows[numOfContacts]);
+		RowVector pos(contactRows.begin(), contactRows.end() - 1);
+
+		column_type circuitIndex = 0;
+		for (Network::circuit_const_iterator circuit = network.circuitBegin(), end = network.circuitEnd(); circuit != end; ++circuit, ++circuitIndex) {
+			for (Circuit::const_iterator ci = circuit->begin(), last = circuit->end(); ci != last; ++ci) {
+				const std::size_t p = pos[ci->index]++;
+				contactCols[p] = circuitIndex;
+				contactGains[p] = ci->gain;
+			}
+		}
+	}
+
+	std::size_t getNumOfContacts() const {
+		return numOfContacts;
+	}
+
+	std::size_t getNumOfCircuits() const {
+		return squares.size();
+	}
+
+	/*
+	 * Calculates phases of circuits [first, last):
+	 * dest[c] = square[c] * sum(weight[c, i] * phases[i])
+	 *
+	 * Phases of several networks sharing the topology may be interleaved
+	 * as lanes: phases[i * lanes + k] belongs to k-th network, so does
+	 * dest[c * lanes + k].
+	 */
+	void circuitPhases(const double* const phases, double* const dest, std::size_t const first, std::size_t const last, std::size_t const lanes = 1) const {
+		const std::size_t* const rows = &circuitRows[0];
+		const column_type* const cols = circuitCols.empty() ? 0 : &circuitCols[0];
+		const double* const weights = circuitWeights.empty() ? 0 : &circuitWeights[0];
+
+		if (1 == lanes) {
+			for (std::size_t c = first; c < last; ++c) {
+				double sum = 0.0;
+				for (std::size_t j = rows[c], end = rows[c + 1]; j < end; ++j) {
+					sum += phases[cols[j]] * weights[j];
+				}
+				dest[c] = sum * squares[c];
+			}
+			return;
+		}
+
+		for (std::size_t c = first; c < last; ++c) {
+			double* const d = dest + c * lanes;
+			for (std::size_t k = 0; k < lanes; ++k) {
+				d[k] = 0.0;
+			}
+			for (std::size_t j = rows[c], end = rows[c + 1]; j < end; ++j) {
+				const double* const p = phases + cols[j] * lanes;
+				const double w = weights[j];
+				for (std::size_t k = 0; k < lanes; ++k) {
+					d[k] += p[k] * w;
+				}
+			}
+			for (std::size_t k = 0; k < lanes; ++k) {
+				d[k] *= squares[c];
+			}
+		}
+	}
+
+	void circuitPhases(const double* const phases, double* const dest) const {
+		circuitPhases(phases, dest, 0, squares.size());
+	}
+
+	/*
+	 * Calculates circuit feedback on a contact:
+	 * sum(gain[i, c] * circuitPhases[c])
+	 */
+	double feedback(std::size_t const i, const double* const circuitPhases) const {
+		double sum = 0.0;
+		for (std::size_t j = contactRows[i], end = contactRows[i + 1]; j < end; ++j) {
+			sum += circuitPhases[contactCols[j]] * contactGains[j];
+		}
+		return sum;
+	}
+
+	/*
+	 * Calculates circuit feedback on a contact for interleaved lanes:
+	 * dest[k] = sum(gain[i, c] * circuitPhases[c * lanes + k])
+	 */
+	void feedback(std::size_t const i, const double* const circuitPhases, std::size_t const lanes, double* const dest) const {
+		for (std::size_t k = 0; k < lanes; ++k) {
+			dest[k] = 0.0;
+		}
+		for (std::size_t j = contactRows[i], end = contactRows[i + 1]; j < end; ++j) {
+			const double* const p = circuitPhases + contactCols[j] * lanes;
+			const double g = contactGains[j];
+			for (std::size_t k = 0; k < lanes; ++k) {
+				dest[k] += p[k] * g;
+			}
+		}
+	}
+
+	/*
+	 * Applies linear coupling operator L: dest[i] = feedback(i, circuitPhases(x)).
+	 * buffer must hold getNumOfCircuits() * lanes values.
+	 */
+	void couple(const double* const x, double* const buffer, double* const dest, std::size_t const lanes = 1) const {
+		circuitPhases(x, buffer, 0, squares.size(), lanes);
+		if (1 == lanes) {
+			for (std::size_t i = 0; i < numOfContacts; ++i) {
+				dest[i] = feedback(i, buffer);
+			}
+		} else {
+			for (std::size_t i = 0; i < numOfContacts; ++i) {
+				feedback(i, buffer, lanes, dest + i * lanes);
+			}
+		}
+	}
+
+	/*
+	 * Calculates diagonal of the coupling operator L.
+	 */
+	void couplingDiagonal(double* const dest) const {
+		for (std::size_t i = 0; i < numOfContacts; ++i) {
+			double sum = 0.0;
+			for (std::size_t j = contactRows[i], end = contactRows[i + 1]; j < end; ++j) {
+				const column_type c = contactCols[j];
+				for (std::size_t k = circuitRows[c], last = circuitRows[c + 1]; k < last; ++k) {
+					if (circuitCols[k] == i) {
+						sum += contactGains[j] * squares[c] * circuitWeights[k];
+					}
+				}
+			}
+			dest[i] = sum;
+		}
+	}
+
+	bool operator==(const Incidence& other) const {
+		return numOfContacts == other.numOfContacts
+			&& circuitRows == other.circuitRows
+			&& circuitCols == other.circuitCols
+			&& circuitWeights == other.circuitWeights
+			&& squares == other.squares
+			&& contactRows == other.contactRows
+			&& contactCols == other.contactCols
+			&& contactGains == other.contactGains;
+	}
+
+	bool operator!=(const Incidence& other) const {
+		return !(*this == other);
+	}
+
+private:
+
+	std::size_t numOfContacts;
+
+	// circuit -> contacts
+	RowVector circuitRows;
+	ColumnVector circuitCols;
+	ValueVector circuitWeights;
+	ValueVector squares;
+
+	// contact -> circuits
+	RowVector contactRows;
+	ColumnVector contactCols;
+	ValueVector contactGains;
+
+};
+
+#endif /* CALC_INCIDENCE_HPP_ */
@@ -14,22 +14,34 @@
 #ifndef CALC_INTEGRATOR_HPP_
 #define CALC_INTEGRATOR_HPP_
 
+#include <math.h>
+#include <algorithm>
+#include <sstream>
 #include <stdexcept>
 #include <vector>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_matrix.h>
-#include <gsl/gsl_odeiv.h>
+#include <gsl/gsl_odeiv2.h>
+#include <boost/atomic.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
 #include <phlib/cloneable.hpp>
 #include "network.hpp"
+#include "incidence.hpp"
+#include "implicit_system.hpp"
+#include "rhs_kernel.hpp"
+#include "stepper.hpp"
+#include "dopri5.hpp"
+#include "checkpoint.hpp"
+#include "event_detector.hpp"
+#include "steady_state.hpp"
+#include "run_stats.hpp"
 #include "abstract_tracer.hpp"
 #include "abstract_perturbator.hpp"
 
-class Integrator : public phlib::Cloneable {
+class Integrator : public phlib::Cloneable, private ImplicitSystem {
 
-	typedef std::vector<AbstractTracer*> TracerVector;
-	typedef std::vector<AbstractPerturbator*> PerturbatorVector;
-
-	class IntegrationError : std::runtime_error {
+	class IntegrationError : public std::runtime_error {
 
 		static std::string makeMsg(const int err) {
 			std::stringstream s;
@@ -43,20 +55,9 @@ class Integrator : public phlib::Cloneable {
 
 	};
 
-	struct CircuitRef {
-		int index;
-		double gain;
-
-		CircuitRef() : index(-1) {}
-	};
-
-	struct CircuitRefPack {
-		CircuitRef first, second, third, fourth;
-	};
-
-	typedef std::vector<CircuitRefPack> CircuitRefPackVector;
-
-	Integrator(const Integrator& src) : params(src.params) {}
+	Integrator(const Integrator& src) : params(src.params) {
+		init();
+	}
 
 	virtual phlib::Cloneable* doClone() const {
 		return new Integrator(*this);
@@ -67,51 +68,182 @@ public:
 	struct Params {
 		double step;
 		double absErr, relErr;
+		std::string simd;
+		unsigned threads;	// 0 means all hardware threads
+		std::string stepper;
+		std::string checkpointFile;	// suffixed by network index for ensembles
+		double checkpointInterval;	// 0 means no checkpoints
+		bool denseOutput;	// interpolate states at time points instead of stepping to them, see runDense()
+		double steadyWindow;	// stop run once steady over windows of this length, 0 means never
+		double steadyTolerance;	// of mean voltage and flux over window, see SteadyState
+		std::string statsFile;	// JSON summary of every run, see RunStats
 
 		Params() :
 			step(1.0e-6),
 			absErr(0.0),
-			relErr(1.0e-6)
+			relErr(1.0e-6),
+			simd("auto"),
+			threads(1),
+			stepper("rkf45"),
+			checkpointInterval(0.0),
+			denseOutput(false),
+			steadyWindow(0.0),
+			steadyTolerance(1.0e-4)
 		{}
 	};
 
-	Integrator(const Params& params) : params(params) {}
+	typedef std::vector<Network*> NetworkVector;
+	typedef std::vector<AbstractTracer*> TracerVector;
+	typedef std::vector<AbstractPerturbator*> PerturbatorVector;
+
+	/*
+	 * Observes progress of a run, called at every time point.
+	 */
+	struct Monitor {
+
+		virtual ~Monitor() {}
+
+		virtual void onTimePoint(double time, const RunStats& stats) = 0;
+
+	};
+
+	Integrator(const Params& params) : params(params) {
+		init();
+	}
 
 	void run(Network& network, double const startTime, double const endTime, double const dt) {
-		const int numOfEqs = network.getNumOfContacts() * 2;
-		this->network = &network;
-		gsl_odeiv_step* s = gsl_odeiv_step_alloc(gsl_odeiv_step_rkf45, numOfEqs);
-		gsl_odeiv_control* c = gsl_odeiv_control_y_new(params.absErr, params.relErr);
-		gsl_odeiv_evolve* e = gsl_odeiv_evolve_alloc(numOfEqs);
-		gsl_odeiv_system sys = {&solver, NULL, numOfEqs, this};
+		run(NetworkVector(1, &network), startTime, endTime, dt);
+	}
 
-		beforeRun(network, startTime, endTime, dt);
+	/*
+	 * Integrates ensemble of networks sharing the same topology in one pass,
+	 * states of networks are interleaved in a single system (see RhsKernel).
+	 * Step size is shared by all networks and controlled by the worst error
+	 * among them. Perturbators are applied to every network, tracers
+	 * observe the first one.
+	 *
+	 * Solver stops at every time point unless dense output is on, see
+	 * runDense(). With steady window set the run ends at the time point
+	 * the ensemble becomes steady, see getConvergenceTime(). The run also
+	 * ends at the time point following cancel(), pending request is not
+	 * discarded here, see clearCancel().
+	 */
+	void run(const NetworkVector& networks, double const startTime, double const endTime, double const dt) {
+		if (networks.empty()) {
+			throw std::invalid_argument("no networks to integrate");
+		}
 
-		buildCircuitRefs();
-		y.resize(numOfEqs);
-		getYValues(network);
+		Network& network = *networks.front();
+
+		stats = RunStats();
+		cancelled = false;
+		const RunStats::Stopwatch wall;
 
+		beforeRun(networks, startTime, endTime, dt);
+
+		prepare(networks);
+		getYValues(networks);
+		setDrives(networks);
+
+		if (detector) {
+			detector->setup(incidence, networks.size());
+			detector->setWindings(windings.empty() ? 0 : &windings[0]);
+		}
+
+		double h = initialStep(networks);
+
+		// run resumed from checkpoint continues on the same time grid
+		double origin = startTime;
 		unsigned long timeSteps = 1;
-		for (double time = startTime; time <= endTime; ++timeSteps) {
-			double h = params.step;
-			double t = time;
+		if (resumed.network == &network && resumed.time == startTime && resumed.dt == dt) {
+			origin = resumed.origin;
+			timeSteps = resumed.steps + 1;
+		}
+		resumed = Resumed();
 
-			time = startTime + timeSteps * dt;
+		double nextCheckpoint = startTime + params.checkpointInterval;
+		steady = SteadyState(params.steadyWindow, params.steadyTolerance);
+		steady.reset(startTime);
 
-			// start integration loop
-			while (t < time) {
-				const int status = ::gsl_odeiv_evolve_apply(e, c, s, &sys, &t, time, &h, &y[0]);
-				if (status != GSL_SUCCESS) {
-					throw IntegrationError(status);
+		if (params.denseOutput) {
+			runDense(networks, startTime, endTime, dt, origin, timeSteps, h, nextCheckpoint);
+		} else {
+			for (double time = startTime; time <= endTime; ++timeSteps) {
+				const double t = time;
+
+				time = origin + timeSteps * dt;
+				integrate(t, time, h, detector);
+				wrapPhases(detector);
+
+				setYValues(networks, y);
+				if (timePoint(networks, time, origin, dt, timeSteps, h, nextCheckpoint)) {
+					break;
 				}
 			}
-			// integration completed
+		}
+
+		afterRun(networks);
+
+		stats.wallTime = wall.elapsed();
+		if (!params.statsFile.empty()) {
+			stats.save(params.statsFile);
+		}
+	}
+
+	/*
+	 * Saves network at given time along with accepted step size.
+	 */
+	void save(const std::string& fileName, const Network& network, double const time) const {
+		Checkpoint checkpoint;
+		checkpoint.time = checkpoint.origin = time;
+		checkpoint.step = lastNetworks == NetworkVector(1, const_cast<Network*>(&network)) ? lastStep : 0.0;
+		checkpoint.save(fileName, network);
+	}
+
+	/*
+	 * Loads network and accepted step size. Run of the network started at
+	 * the time of checkpoint with the same dt continues exactly as the
+	 * interrupted one. Returns time of checkpoint.
+	 */
+	double load(const std::string& fileName, Network& network) {
+		Checkpoint checkpoint;
+		checkpoint.load(fileName, network);
+
+		lastNetworks.assign(1, &network);
+		lastStep = checkpoint.step;
+
+		resumed.network = &network;
+		resumed.time = checkpoint.time;
+		resumed.origin = checkpoint.origin;
+		resumed.dt = checkpoint.dt;
+		resumed.steps = checkpoint.steps;
+
+		return checkpoint.time;
+	}
 
-			setYValues(network);
-			afterIteration(network, time);
+	void advance(Network& network, double const startTime, double const endTime) {
+		advance(NetworkVector(1, &network), startTime, endTime);
+	}
+
+	/*
+	 * Integrates networks from startTime to endTime in a single interval.
+	 * Neither tracers, perturbators nor event detector are involved, so this is the cheap
+	 * way to continue integration in a loop (see Sweep).
+	 */
+	void advance(const NetworkVector& networks, double const startTime, double const endTime) {
+		if (networks.empty()) {
+			throw std::invalid_argument("no networks to integrate");
 		}
 
-		afterRun(network);
+		prepare(networks);
+		getYValues(networks);
+		kernel.clearDrives();
+
+		double h = initialStep(networks);
+		integrate(startTime, endTime, h, 0);
+		wrapPhases(0);
+
+		setYValues(networks, y);
 	}
 
 	void addTracer(AbstractTracer& tracer) {
@@ -122,6 +254,10 @@ public:
 		tracers.clear();
 	}
 
+	const TracerVector& getTracers() const {
+		return tracers;
+	}
+
 	void addPerturbator(AbstractPerturbator& perturbator) {
 		perturbators.push_back(&perturbator);
 	}
@@ -130,148 +266,553 @@ public:
 		perturbators.clear();
 	}
 
+	const PerturbatorVector& getPerturbators() const {
+		return perturbators;
+	}
+
+	/*
+	 * Every accepted step of run() is checked for events by detector, null
+	 * disables detection.
+	 */
+	void setEventDetector(EventDetector* const detector) {
+		this->detector = detector;
+	}
+
 	Params& getParams() {
 		return params;
 	}
 
+	/*
+	 * Step size accepted by the end of last run, 0 if integrator did not run yet.
+	 */
+	double getLastStep() const {
+		return lastStep;
+	}
+
+	/*
+	 * Requests current run to stop at the next time point, networks are
+	 * left in the state at that point. May be called from any thread,
+	 * also before the run has entered run().
+	 */
+	void cancel() {
+		cancelRequest = true;
+	}
+
+	/*
+	 * Discards cancel request left from a previous run, called by whoever
+	 * starts a run before it is started.
+	 */
+	void clearCancel() {
+		cancelRequest = false;
+	}
+
+	/*
+	 * Whether the last run was stopped by cancel().
+	 */
+	bool wasCancelled() const {
+		return cancelled;
+	}
+
+	void setMonitor(Monitor* const monitor) {
+		this->monitor = monitor;
+	}
+
+	/*
+	 * Statistics of the last run. Intervals integrated by advance() since
+	 * then add to its counters, but not to wall time.
+	 */
+	const RunStats& getStats() const {
+		return stats;
+	}
+
+	/*
+	 * Time the last run became steady at, negative if it did not or steady
+	 * window is not set.
+	 */
+	double getConvergenceTime() const {
+		return steady.getConvergenceTime();
+	}
+
 private:
 
 	Params params;
 	TracerVector tracers;
 	PerturbatorVector perturbators;
-	std::vector<double> y;
-	Network* network;
-	CircuitRefPackVector circuitRefs;
-	std::vector<double> circuitPhases;
+	double lastStep;
+	NetworkVector lastNetworks;
+	EventDetector* detector;
+	SteadyState steady;
+	RunStats stats;
+	Monitor* monitor;
+	boost::atomic<bool> cancelRequest;
+	bool cancelled;
+
+	// time grid of the run interrupted by checkpoint
+	struct Resumed {
+		const Network* network;
+		double time, origin, dt;
+		unsigned long steps;
+
+		Resumed() : network(0), time(0.0), origin(0.0), dt(0.0), steps(0) {}
+	} resumed;
+
+	// workspace reused by successive runs
+	gsl_odeiv2_system sys;
+	boost::shared_ptr<gsl_odeiv2_driver> driver;
+	std::string driverStepper;
+	std::vector<double> y, yPrev, yDense, dydtPrev;
+	Network::WindingVector windings;
+	Incidence incidence;
+	RhsKernel kernel;
+	std::vector<unsigned long> topologyRevisions, parameterRevisions;
+	boost::scoped_ptr<ThreadPool> pool;
+
+	void init() {
+		lastStep = 0.0;
+		detector = 0;
+		monitor = 0;
+		cancelRequest = false;
+		cancelled = false;
+		sys.function = &solver;
+		sys.jacobian = NULL;
+		sys.dimension = 0;
+		sys.params = this;
+	}
 
-	void beforeRun(Network& network, double const startTime, double const endTime, double const dt) {
-		for (PerturbatorVector::iterator i = perturbators.begin(), last = perturbators.end(); i != last; ++i) {
-			(*i)->beforeRun(network, startTime, endTime, dt);
+	/*
+	 * Brings workspace in accordance with networks and parameters.
+	 * Structures are rebuilt only if network topology, contact parameters
+	 * or size of the system have changed since the previous run.
+	 */
+	void prepare(const NetworkVector& networks) {
+		const std::size_t numOfLanes = networks.size();
+		const std::size_t numOfEqs = networks.front()->getNumOfContacts() * 2 * numOfLanes;
+
+		if (!driver || sys.dimension != numOfEqs || driverStepper != params.stepper) {
+			const Stepper stepper(params.stepper);
+			sys.dimension = numOfEqs;
+			driver.reset();
+			driver.reset(
+				gsl_odeiv2_driver_alloc_y_new(&sys, stepper.getType(), params.step, params.absErr, params.relErr),
+				gsl_odeiv2_driver_free);
+			driverStepper = params.stepper;
+
+			if (stepper.isImplicit()) {
+				setImplicitSystem(driver->s, this);
+			}
+		} else {
+			gsl_odeiv2_driver_reset(driver.get());
+			gsl_odeiv2_control_init(driver->c, params.absErr, params.relErr, 1.0, 0.0);
 		}
 
-		for (TracerVector::iterator i = tracers.begin(), last = tracers.end(); i != last; ++i) {
-			(*i)->beforeRun(network, startTime, endTime, dt);
+		bool setupKernel = topologyRevisions.size() != numOfLanes;
+		topologyRevisions.resize(numOfLanes, 0);
+		parameterRevisions.resize(numOfLanes, 0);
+
+		const Network& network = *networks.front();
+		if (topologyRevisions[0] != network.getTopologyRevision()) {
+			incidence.build(network);
+			topologyRevisions.assign(numOfLanes, 0);
+			topologyRevisions[0] = network.getTopologyRevision();
+			setupKernel = true;
+		}
+
+		for (std::size_t k = 1; k < numOfLanes; ++k) {
+			if (topologyRevisions[k] != networks[k]->getTopologyRevision()) {
+				Incidence other;
+				other.build(*networks[k]);
+				if (other != incidence) {
+					// kernel is not set up, force it next time
+					topologyRevisions.clear();
+					throw std::invalid_argument("networks of ensemble must share topology");
+				}
+				topologyRevisions[k] = networks[k]->getTopologyRevision();
+				setupKernel = true;
+			}
+		}
+
+		for (std::size_t k = 0; k < numOfLanes; ++k) {
+			if (parameterRevisions[k] != networks[k]->getParameterRevision()) {
+				parameterRevisions[k] = networks[k]->getParameterRevision();
+				setupKernel = true;
+			}
+		}
+
+		if (setupKernel) {
+			kernel.setup(RhsKernel::NetworkVector(networks.begin(), networks.end()), incidence);
 		}
+
+		kernel.setContactKernel(ContactKernel(params.simd));
+		kernel.setThreadPool(threadPool());
+		y.resize(numOfEqs);
+		windings.resize(numOfEqs / 2);
 	}
 
-	void afterRun(Network& network) {
-		for (TracerVector::iterator i = tracers.begin(), last = tracers.end(); i != last; ++i) {
-			(*i)->afterRun(network);
+	// time-dependent fields of perturbators are evaluated by kernel
+	void setDrives(const NetworkVector& networks) {
+		kernel.clearDrives();
+		for (PerturbatorVector::const_iterator i = perturbators.begin(), last = perturbators.end(); i != last; ++i) {
+			if (const FieldDrive* const drive = (*i)->fieldDrive()) {
+				kernel.addDrive(*drive, RhsKernel::NetworkVector(networks.begin(), networks.end()));
+			}
 		}
+	}
 
-		for (PerturbatorVector::iterator i = perturbators.begin(), last = perturbators.end(); i != last; ++i) {
-			(*i)->afterRun(network);
+	void saveCheckpoint(const Checkpoint& checkpoint, const NetworkVector& networks) const {
+		if (1 == networks.size()) {
+			checkpoint.save(params.checkpointFile, *networks.front());
+			return;
+		}
+
+		for (std::size_t k = 0; k < networks.size(); ++k) {
+			std::stringstream s;
+			s << params.checkpointFile << '.' << k;
+			checkpoint.save(s.str(), *networks[k]);
 		}
 	}
 
-	void afterIteration(const Network& network, double const time) {
-		for (TracerVector::iterator i = tracers.begin(), last = tracers.end(); i != last; ++i) {
-			(*i)->afterIteration(network, time);
+	// accepted step size is carried over intervals and successive runs on the same networks
+	double initialStep(const NetworkVector& networks) {
+		const double h = networks == lastNetworks && lastStep > 0.0 ? lastStep : params.step;
+		lastNetworks = networks;
+		return h;
+	}
+
+	// returns true if run is to be stopped
+	bool timePoint(
+			const NetworkVector& networks,
+			double const time,
+			double const origin,
+			double const dt,
+			unsigned long const timeSteps,
+			double const h,
+			double& nextCheckpoint) {
+
+		++stats.timePoints;
+		afterIteration(*networks.front(), time);
+
+		if (monitor) {
+			monitor->onTimePoint(time, stats);
 		}
+
+		if (params.checkpointInterval > 0.0 && !params.checkpointFile.empty() && time >= nextCheckpoint) {
+			Checkpoint checkpoint;
+			checkpoint.time = time;
+			checkpoint.origin = origin;
+			checkpoint.dt = dt;
+			checkpoint.steps = timeSteps;
+			checkpoint.step = h;
+			saveCheckpoint(checkpoint, networks);
+			nextCheckpoint = time + params.checkpointInterval;
+		}
+
+		if (cancelRequest.exchange(false)) {
+			cancelled = true;
+			return true;
+		}
+
+		return params.steadyWindow > 0.0 && steady.sample(time, meanVoltage(networks), meanFlux(networks));
 	}
 
-	void getYValues(const Network& network) {
-		std::vector<double>::iterator i = y.begin();
-		for (Network::contact_const_iterator c = network.contactBegin(), last = network.contactEnd(); c != last; ++c) {
-			*i++ = c->phase;
-			*i++ = c->voltage;
+	static double meanVoltage(const NetworkVector& networks) {
+		double sum = 0.0;
+		std::size_t n = 0;
+		for (NetworkVector::const_iterator k = networks.begin(), last = networks.end(); k != last; ++k) {
+			const Network::ValueVector& voltages = (*k)->getVoltages();
+			for (Network::ValueVector::const_iterator i = voltages.begin(), end = voltages.end(); i != end; ++i) {
+				sum += *i;
+			}
+			n += voltages.size();
 		}
+
+		return n ? sum / n : 0.0;
 	}
 
-	void setYValues(Network& network) {
-		std::vector<double>::const_iterator i = y.begin();
-		for (Network::contact_iterator c = network.contactBegin(), last = network.contactEnd(); c != last; ++c) {
-			c->phase = *i++;
-			c->voltage = *i++;
+	static double meanFlux(const NetworkVector& networks) {
+		double sum = 0.0;
+		std::size_t n = 0;
+		for (NetworkVector::const_iterator k = networks.begin(), last = networks.end(); k != last; ++k) {
+			for (std::size_t i = 0, m = (*k)->getNumOfCircuits(); i < m; ++i) {
+				sum += (*k)->flux(i);
+			}
+			n += (*k)->getNumOfCircuits();
 		}
+
+		return n ? sum / n : 0.0;
 	}
 
-	static int solver(const double t, const double y[], double f[], void* params) {
-		return reinterpret_cast<Integrator*>(params)->solverImpl(t, y, f);
+	/*
+	 * Solver takes its natural steps up to the last time point of the run,
+	 * states at time points within a step are interpolated. dopri5 uses its
+	 * own fourth order continuous extension. Other methods use cubic
+	 * Hermite polynomial from values and derivatives at the ends of the
+	 * step, its error is O(h^4) whatever the order of the method, so with
+	 * rkf45, rkck, rk8pd and msadams interpolated states are less accurate
+	 * than the steps themselves: tighten tolerances or use dopri5.
+	 * Checkpoints hold interpolated states, so a resumed run is close to,
+	 * but not bitwise equal to the uninterrupted one.
+	 */
+	void runDense(
+			const NetworkVector& networks,
+			double const startTime,
+			double const endTime,
+			double const dt,
+			double const origin,
+			unsigned long timeSteps,
+			double& h,
+			double& nextCheckpoint) {
+
+		// the same time points as without dense output
+		double last = startTime;
+		for (unsigned long k = timeSteps; last <= endTime; ++k) {
+			last = origin + k * dt;
+		}
+
+		const std::size_t dim = y.size();
+		yPrev = y;
+		yDense.resize(dim);
+		dydtPrev.resize(dim);
+		solverImpl(startTime, &y[0], &dydtPrev[0]);
+
+		double t = startTime;
+		double time = origin + timeSteps * dt;
+		while (t < last) {
+			const double tPrev = t, hPrev = h;
+			step(t, last, h);
+
+			if (t == last && hPrev > last - tPrev) {
+				h = std::max(h, hPrev);
+			}
+
+			if (detector) {
+				detector->check(tPrev, &yPrev[0], t, &y[0]);
+			}
+
+			const double* const dydt = driver->e->dydt_out;
+			bool sampled = false;
+			for (; time <= t; time = origin + ++timeSteps * dt) {
+				interpolate(tPrev, t, time, dydt);
+				setYValues(networks, yDense);
+				if (timePoint(networks, time, origin, dt, timeSteps, h, nextCheckpoint)) {
+					// networks stay in the state at the time point the run stopped at
+					lastStep = h;
+					return;
+				}
+				sampled = true;
+			}
+
+			if (sampled) {
+				wrapPhases(detector);
+			}
+
+			yPrev = y;
+			std::copy(dydt, dydt + dim, dydtPrev.begin());
+		}
+
+		setYValues(networks, y);
+		lastStep = h;
 	}
 
-	int solverImpl(const double t, const double y[], double f[]) {
-		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
-
-		buildCircuitPhases();
-
-		int i = 0;
-		CircuitRefPackVector::const_iterator ref = circuitRefs.begin();
-		for (
-				Network::contact_const_iterator c = network->contactBegin(), end = network->contactEnd();
-				c != end;
-				++c, ++ref, i += 2) {
-			/*
-			 * y[i]    : phi(t)
-			 * y[i + 1]: u(t)
-			 * f[i]    : d(phi)/dt
-			 * f[i + 1]: d(u)/dt
-			 */
-			f[i] = y[i + 1];
-			f[i + 1] = 1.0 / c->beta * (
-				- twoPi * (c->h * c->hNormal)
-				- calcCircuits(*ref)
-				- c->tau * y[i + 1]
-				- c->v * sin(y[i])
-			);
+	// state at time between ends of the last step
+	void interpolate(double const t0, double const t1, double const time, const double* const dydt) {
+		if (driver->s->type == dopri5StepType && dopri5Interpolate(driver->s, time, &yDense[0])) {
+			return;
 		}
 
-		return GSL_SUCCESS;
+		const double h = t1 - t0;
+		const double s = (time - t0) / h, s2 = s * s, s3 = s2 * s;
+		const double h00 = 2.0 * s3 - 3.0 * s2 + 1.0, h10 = (s3 - 2.0 * s2 + s) * h;
+		const double h01 = 3.0 * s2 - 2.0 * s3, h11 = (s3 - s2) * h;
+
+		for (std::size_t i = 0, n = y.size(); i < n; ++i) {
+			yDense[i] = h00 * yPrev[i] + h10 * dydtPrev[i] + h01 * y[i] + h11 * dydt[i];
+		}
+	}
+
+	// single accepted step not beyond t1
+	void step(double& t, double const t1, double& h) {
+		const unsigned long failed = driver->e->failed_steps;
+		const double t0 = t;
+		const RunStats::Stopwatch watch;
+
+		const int status = ::gsl_odeiv2_evolve_apply(driver->e, driver->c, driver->s, &sys, &t, t1, &h, &y[0]);
+		if (status != GSL_SUCCESS) {
+			throw IntegrationError(status);
+		}
+
+		stats.solverTime += watch.elapsed();
+		stats.rejectedSteps += driver->e->failed_steps - failed;
+		stats.addStep(t - t0);
+	}
+
+	void integrate(double t, double const time, double& h, EventDetector* const events) {
+		while (t < time) {
+			const double tPrev = t, hPrev = h;
+			if (events) {
+				yPrev = y;
+			}
+
+			step(t, time, h);
+
+			if (events) {
+				events->check(tPrev, &yPrev[0], t, &y[0]);
+			}
+
+			// step truncated to hit the interval boundary should not shrink the next one
+			if (t == time && hPrev > time - tPrev) {
+				h = std::max(h, hPrev);
+			}
+		}
+
+		lastStep = h;
 	}
 
-	double calcCircuits(const CircuitRefPack& refs) const {
-		return calcCircuit(refs.first) + calcCircuit(refs.second) + calcCircuit(refs.third) + calcCircuit(refs.fourth);
+	// pool is kept between runs and recreated only if number of threads changes
+	ThreadPool* threadPool() {
+		const unsigned numOfThreads = params.threads > 0 ? params.threads : ThreadPool::hardwareConcurrency();
+
+		if (numOfThreads <= 1) {
+			pool.reset();
+		} else if (!pool || pool->getNumOfThreads() != numOfThreads) {
+			pool.reset();
+			pool.reset(new ThreadPool(numOfThreads));
+		}
+
+		return pool.get();
 	}
 
-	double calcCircuit(const CircuitRef& ref) const {
-		if (ref.index < 0) {
-			return 0.0;
+	void beforeRun(const NetworkVector& networks, double const startTime, double const endTime, double const dt) {
+		for (PerturbatorVector::iterator i = perturbators.begin(), last = perturbators.end(); i != last; ++i) {
+			for (NetworkVector::const_iterator n = networks.begin(), nl = networks.end(); n != nl; ++n) {
+				(*i)->beforeRun(**n, startTime, endTime, dt);
+			}
 		}
 
-		return circuitPhases[ref.index] * ref.gain;
+		const RunStats::Stopwatch watch;
+		for (TracerVector::iterator i = tracers.begin(), last = tracers.end(); i != last; ++i) {
+			(*i)->beforeRun(*networks.front(), startTime, endTime, dt);
+		}
+		stats.tracerTime += watch.elapsed();
 	}
 
-	void buildCircuitRefs() {
-		circuitRefs.clear();
-		circuitRefs.resize(network->getNumOfContacts());
+	void afterRun(const NetworkVector& networks) {
+		const RunStats::Stopwatch watch;
+		for (TracerVector::iterator i = tracers.begin(), last = tracers.end(); i != last; ++i) {
+			(*i)->afterRun(*networks.front());
+		}
+		stats.tracerTime += watch.elapsed();
 
-		for (
-				Network::circuit_const_iterator first = network->circuitBegin(), circuit = first, end = network->circuitEnd();
-				circuit != end;
-				++circuit) {
+		for (PerturbatorVector::iterator i = perturbators.begin(), last = perturbators.end(); i != last; ++i) {
+			for (NetworkVector::const_iterator n = networks.begin(), nl = networks.end(); n != nl; ++n) {
+				(*i)->afterRun(**n);
+			}
+		}
+	}
+
+	void afterIteration(const Network& network, double const time) {
+		const RunStats::Stopwatch watch;
+		for (TracerVector::iterator i = tracers.begin(), last = tracers.end(); i != last; ++i) {
+			(*i)->afterIteration(network, time);
+		}
+		stats.tracerTime += watch.elapsed();
+	}
 
-			for (Circuit::const_iterator ci = circuit->begin(), last = circuit->end(); ci != last; ++ci) {
-				CircuitRefPack& pair = circuitRefs[ci->index];
-				CircuitRef& ref = pair.first.index < 0
-						? pair.first
-						: pair.second.index < 0
-						  ? pair.second
-						  : pair.third.index < 0
-							? pair.third
-							: pair.fourth;
-				ref.index = std::distance(first, circuit);
-				ref.gain = ci->gain;
+	// values of k-th network are interleaved as k-th lane
+	void getYValues(const NetworkVector& networks) {
+		const std::size_t lanes = networks.size(), n = y.size() / 2;
+		for (std::size_t k = 0; k < lanes; ++k) {
+			const Network::ValueVector& phases = networks[k]->getPhases();
+			const Network::ValueVector& voltages = networks[k]->getVoltages();
+			const Network::WindingVector& w = networks[k]->getWindings();
+			for (std::size_t i = 0, j = k; j < n; ++i, j += lanes) {
+				y[j] = phases[i];
+				y[n + j] = voltages[i];
+				windings[j] = w[i];
 			}
+		}
+
+		kernel.setWindings(windings.empty() ? 0 : &windings[0]);
+	}
 
+	void setYValues(const NetworkVector& networks, const std::vector<double>& values) {
+		const std::size_t lanes = networks.size(), n = values.size() / 2;
+		for (std::size_t k = 0; k < lanes; ++k) {
+			Network::ValueVector& phases = networks[k]->getPhases();
+			Network::ValueVector& voltages = networks[k]->getVoltages();
+			Network::WindingVector& w = networks[k]->getWindings();
+			for (std::size_t i = 0, j = k; j < n; ++i, j += lanes) {
+				phases[i] = values[j];
+				voltages[i] = values[n + j];
+				w[i] = windings[j];
+			}
 		}
 	}
 
-	void buildCircuitPhases() {
-		circuitPhases.resize(network->getNumOfCircuits());
-		std::vector<double>::iterator dest = circuitPhases.begin();
-		for (
-				Network::circuit_const_iterator first = network->circuitBegin(), circuit = first, end = network->circuitEnd();
-				circuit != end;
-				++circuit, ++dest) {
+	/*
+	 * Moves whole turns of phases to windings at time points, so that
+	 * phases are within [-pi, pi) there and sine arguments stay small.
+	 * The system does not change, but history of multistep methods and
+	 * cached stages refer to old phases, so the step is reset, only if
+	 * some phase has actually moved.
+	 */
+	void wrapPhases(EventDetector* const events) {
+		const static double pi = 3.1415926535897932384626433832795;
+		const static double twoPi = 2.0 * pi;
+
+		bool wrapped = false;
+		for (std::size_t i = 0, n = windings.size(); i < n; ++i) {
+			if (y[i] < -pi || y[i] >= pi) {
+				const double turns = floor((y[i] + pi) / twoPi);
+				y[i] -= twoPi * turns;
+				windings[i] += static_cast<long>(turns);
+				wrapped = true;
+			}
+		}
 
-			double sum = 0.0;
-			for (Circuit::const_iterator ci = circuit->begin(), last = circuit->end(); ci != last; ++ci) {
-				const Contact& contact = network->contact(ci->index);
-				sum += contact.phase * ci->weight;
+		if (wrapped) {
+			kernel.setWindings(&windings[0]);
+			if (events) {
+				events->setWindings(&windings[0]);
 			}
-			*dest = sum * circuit->square;
+			gsl_odeiv2_step_reset(driver->s);
 		}
 	}
+
+	static int solver(const double t, const double y[], double f[], void* params) {
+		return reinterpret_cast<Integrator*>(params)->solverImpl(t, y, f);
+	}
+
+	int solverImpl(const double t, const double y[], double f[]) {
+		const RunStats::Stopwatch watch;
+		kernel.evaluate(t, y, f);
+		stats.rhsTime += watch.elapsed();
+		++stats.rhsEvaluations;
+		return GSL_SUCCESS;
+	}
+
+	// implicit steppers call kernel through these, so that their work is counted
+
+	virtual int solve(double const t, const double y[], double const a, const double r[], double k[]) {
+		const RunStats::Stopwatch watch;
+		const int status = kernel.solve(t, y, a, r, k);
+		stats.linearSolveTime += watch.elapsed();
+		return status;
+	}
+
+	virtual int evaluateNonlinear(double const t, const double y[], double f[]) {
+		const RunStats::Stopwatch watch;
+		const int status = kernel.evaluateNonlinear(t, y, f);
+		stats.rhsTime += watch.elapsed();
+		++stats.rhsEvaluations;
+		return status;
+	}
+
+	virtual int solveLinear(double const a, const double r[], double k[]) {
+		const RunStats::Stopwatch watch;
+		const int status = kernel.solveLinear(a, r, k);
+		stats.linearSolveTime += watch.elapsed();
+		return status;
+	}
 };
 
 
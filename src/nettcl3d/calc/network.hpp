@@ -14,74 +14,211 @@
 #ifndef CALC_NETWORK_HPP_
 #define CALC_NETWORK_HPP_
 
+#include <algorithm>
 #include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/atomic.hpp>
 #include <phlib/cloneable.hpp>
 #include "contact.hpp"
 #include "circuit.hpp"
 
+/*
+ * Contact parameters and state are kept in contiguous per-field arrays
+ * (structure of arrays) so that integration walks only the data it needs.
+ * Tags and properties of contacts are rarely used and live in a separate
+ * cold table.
+ *
+ * Phase of a contact is kept as a value and an integer number of whole
+ * turns (winding), so that phases of contacts in running state do not
+ * grow without bound. Integrator moves whole turns to windings at every
+ * time point, leaving the value within [-pi, pi), getPhase() returns the
+ * full phase.
+ */
 class Network : public phlib::Cloneable {
 
 	virtual phlib::Cloneable* doClone() const {
 		return new Network(*this);
 	}
 
-	Network(const Network& src) : contacts(src.contacts), circuits(src.circuits) {}
+	Network(const Network& src) :
+		betas(src.betas), taus(src.taus), vs(src.vs),
+		hs(src.hs), hNormals(src.hNormals),
+		phases(src.phases), voltages(src.voltages), windings(src.windings),
+		contactTagables(src.contactTagables),
+		contactTagSource(src.contactTagSource), contactTagOffset(src.contactTagOffset),
+		circuits(src.circuits),
+		topologyRevision(0), parameterRevision(0) {}
 
 public:
 
 	typedef std::size_t index_type;
 	typedef std::vector<Network::index_type> IndexVector;
 
-	typedef std::vector<Contact> ContactVector;
-	typedef ContactVector::iterator contact_iterator;
-	typedef ContactVector::const_iterator contact_const_iterator;
+	typedef std::vector<double> ValueVector;
+	typedef std::vector<long> WindingVector;
+	typedef std::vector<Point> PointVector;
+	typedef std::vector<Tagable> TagableVector;
 
 	typedef std::vector<Circuit> CircuitVector;
 	typedef CircuitVector::iterator circuit_iterator;
 	typedef CircuitVector::const_iterator circuit_const_iterator;
 
-	Network() {
+	/*
+	 * Source of contact tags and properties which are materialized on
+	 * first access, so that networks loaded from files start quickly.
+	 */
+	struct TagSource {
+
+		virtual ~TagSource() {}
+
+		// fills tags of all contacts of the source
+		virtual void fill(Tagable* dest) const = 0;
+
+	};
+
+	typedef boost::shared_ptr<const TagSource> TagSourcePtr;
+
+	Network() : contactTagOffset(0), topologyRevision(0), parameterRevision(0) {
 	}
 
-	ContactVector::size_type getNumOfContacts() const {
-		return contacts.size();
+	ValueVector::size_type getNumOfContacts() const {
+		return phases.size();
 	}
 
 	CircuitVector::size_type getNumOfCircuits() const {
 		return circuits.size();
 	}
 
-	Contact& contact(std::size_t const index) {
-		return contacts[index];
+	double getBeta(index_type const index) const {
+		return betas[index];
 	}
 
-	const Contact& contact(std::size_t const index) const {
-		return contacts[index];
+	void setBeta(index_type const index, double const value) {
+		betas[index] = value;
+		parameterRevision = 0;
 	}
 
-	Circuit& circuit(std::size_t const index) {
-		return circuits[index];
+	double getTau(index_type const index) const {
+		return taus[index];
 	}
 
-	const Circuit& circuit(std::size_t const index) const {
-		return circuits[index];
+	void setTau(index_type const index, double const value) {
+		taus[index] = value;
+		parameterRevision = 0;
+	}
+
+	double getV(index_type const index) const {
+		return vs[index];
+	}
+
+	void setV(index_type const index, double const value) {
+		vs[index] = value;
+		parameterRevision = 0;
+	}
+
+	const Point& getH(index_type const index) const {
+		return hs[index];
+	}
+
+	void setH(index_type const index, const Point& value) {
+		hs[index] = value;
+		parameterRevision = 0;
+	}
+
+	const Point& getHNormal(index_type const index) const {
+		return hNormals[index];
+	}
+
+	void setHNormal(index_type const index, const Point& value) {
+		hNormals[index] = value;
+		parameterRevision = 0;
+	}
+
+	double getPhase(index_type const index) const {
+		return phases[index] + twoPi() * windings[index];
+	}
+
+	void setPhase(index_type const index, double const value) {
+		phases[index] = value;
+		windings[index] = 0;
+	}
+
+	long getWinding(index_type const index) const {
+		return windings[index];
+	}
+
+	double getVoltage(index_type const index) const {
+		return voltages[index];
+	}
+
+	void setVoltage(index_type const index, double const value) {
+		voltages[index] = value;
+	}
+
+	const ValueVector& getBetas() const {
+		return betas;
+	}
+
+	const ValueVector& getTaus() const {
+		return taus;
+	}
+
+	const ValueVector& getVs() const {
+		return vs;
+	}
+
+	const PointVector& getHs() const {
+		return hs;
 	}
 
-	contact_const_iterator contactBegin() const {
-		return contacts.begin();
+	const PointVector& getHNormals() const {
+		return hNormals;
 	}
 
-	contact_iterator contactBegin() {
-		return contacts.begin();
+	/*
+	 * Phases without whole turns, see getWindings().
+	 */
+	const ValueVector& getPhases() const {
+		return phases;
 	}
 
-	contact_const_iterator contactEnd() const {
-		return contacts.end();
+	ValueVector& getPhases() {
+		return phases;
 	}
 
-	contact_iterator contactEnd() {
-		return contacts.end();
+	const WindingVector& getWindings() const {
+		return windings;
+	}
+
+	WindingVector& getWindings() {
+		return windings;
+	}
+
+	const ValueVector& getVoltages() const {
+		return voltages;
+	}
+
+	ValueVector& getVoltages() {
+		return voltages;
+	}
+
+	Tagable& contactTagable(index_type const index) {
+		materializeTags();
+		return contactTagables[index];
+	}
+
+	const Tagable& contactTagable(index_type const index) const {
+		materializeTags();
+		return contactTagables[index];
+	}
+
+	Circuit& circuit(std::size_t const index) {
+		topologyRevision = 0;
+		return circuits[index];
+	}
+
+	const Circuit& circuit(std::size_t const index) const {
+		return circuits[index];
 	}
 
 	circuit_const_iterator circuitBegin() const {
@@ -89,6 +226,7 @@ public:
 	}
 
 	circuit_iterator circuitBegin() {
+		topologyRevision = 0;
 		return circuits.begin();
 	}
 
@@ -97,23 +235,117 @@ public:
 	}
 
 	circuit_iterator circuitEnd() {
+		topologyRevision = 0;
 		return circuits.end();
 	}
 
 	std::size_t addContact(const Contact& c) {
-		const std::size_t index = contacts.size();
-		contacts.push_back(c);
+		const std::size_t index = phases.size();
+		betas.push_back(c.beta);
+		taus.push_back(c.tau);
+		vs.push_back(c.v);
+		hs.push_back(c.h);
+		hNormals.push_back(c.hNormal);
+		phases.push_back(c.phase);
+		voltages.push_back(c.voltage);
+		windings.push_back(0);
+		contactTagables.push_back(c);
+		topologyRevision = 0;
+		parameterRevision = 0;
 		return index;
 	}
 
+	/*
+	 * Appends n contacts at rest given by parameter arrays, points are
+	 * stored as (x, y, z) triples. Tags are taken from source when needed.
+	 */
+	void addContacts(
+			std::size_t const n,
+			const double* const betas,
+			const double* const taus,
+			const double* const vs,
+			const double* const hs,
+			const double* const hNormals,
+			const TagSourcePtr& tags) {
+
+		materializeTags();
+		const std::size_t first = phases.size();
+
+		this->betas.insert(this->betas.end(), betas, betas + n);
+		this->taus.insert(this->taus.end(), taus, taus + n);
+		this->vs.insert(this->vs.end(), vs, vs + n);
+		this->hs.reserve(first + n);
+		this->hNormals.reserve(first + n);
+		for (std::size_t i = 0; i < n; ++i) {
+			this->hs.push_back(Point(hs[3 * i], hs[3 * i + 1], hs[3 * i + 2]));
+			this->hNormals.push_back(Point(hNormals[3 * i], hNormals[3 * i + 1], hNormals[3 * i + 2]));
+		}
+		phases.resize(first + n, 0.0);
+		voltages.resize(first + n, 0.0);
+		windings.resize(first + n, 0);
+		contactTagables.resize(first + n);
+
+		if (n > 0) {
+			contactTagSource = tags;
+			contactTagOffset = first;
+		}
+		topologyRevision = 0;
+		parameterRevision = 0;
+	}
+
+	void reserveCircuits(std::size_t const n) {
+		circuits.reserve(n);
+	}
+
 	std::size_t addCircuit(const Circuit& c) {
 		const std::size_t index = circuits.size();
 		circuits.push_back(c);
+		topologyRevision = 0;
 		return index;
 	}
 
+	/*
+	 * Exchanges contents with another network, both are considered modified.
+	 */
+	void swap(Network& other) {
+		betas.swap(other.betas);
+		taus.swap(other.taus);
+		vs.swap(other.vs);
+		hs.swap(other.hs);
+		hNormals.swap(other.hNormals);
+		phases.swap(other.phases);
+		voltages.swap(other.voltages);
+		windings.swap(other.windings);
+		contactTagables.swap(other.contactTagables);
+		contactTagSource.swap(other.contactTagSource);
+		std::swap(contactTagOffset, other.contactTagOffset);
+		circuits.swap(other.circuits);
+		topologyRevision = parameterRevision = 0;
+		other.topologyRevision = other.parameterRevision = 0;
+	}
+
+	/*
+	 * Revisions identify current state of topology (contacts and circuits)
+	 * and of contact parameters, so that structures derived from them can
+	 * be cached. Revision numbers are unique among all networks.
+	 */
+	unsigned long getTopologyRevision() const {
+		if (!topologyRevision) {
+			topologyRevision = nextRevision();
+		}
+		return topologyRevision;
+	}
+
+	unsigned long getParameterRevision() const {
+		if (!parameterRevision) {
+			parameterRevision = nextRevision();
+		}
+		return parameterRevision;
+	}
+
 	IndexVector buildContactIndices(const std::string& expr) const {
-		return buildIndices(expr, contactBegin(), contactEnd());
+		materializeTags();
+		return buildIndices(expr, contactTagables.begin(), contactTagables.end());
 	}
 
 	IndexVector buildCircuitIndices(const std::string& expr) const {
@@ -126,7 +358,7 @@ public:
 		double sum = 0.0;
 
 		for (Circuit::const_iterator i = c.begin(), last = c.end(); i != last; ++i) {
-			sum += i->weight * contact(i->index).phase;
+			sum += i->weight * getPhase(i->index);
 		}
 
 		return c.square * sum * k;
@@ -134,9 +366,40 @@ public:
 
 private:
 
-	ContactVector contacts;
+	// hot data: parameters and state of contacts
+	ValueVector betas, taus, vs;
+	PointVector hs, hNormals;
+	ValueVector phases, voltages;
+	WindingVector windings;
+
+	// cold data: tags and properties of contacts, those starting at
+	// contactTagOffset are pending in contactTagSource
+	mutable TagableVector contactTagables;
+	mutable TagSourcePtr contactTagSource;
+	std::size_t contactTagOffset;
+
 	CircuitVector circuits;
 
+	// zero means modified since revision was taken last time
+	mutable unsigned long topologyRevision, parameterRevision;
+
+	void materializeTags() const {
+		if (contactTagSource) {
+			TagSourcePtr source;
+			source.swap(contactTagSource);
+			source->fill(&contactTagables[contactTagOffset]);
+		}
+	}
+
+	static double twoPi() {
+		return 2.0 * 3.1415926535897932384626433832795;
+	}
+
+	static unsigned long nextRevision() {
+		static boost::atomic<unsigned long> counter(0);
+		return ++counter;
+	}
+
 	template <typename Iterator>
 	IndexVector buildIndices(const std::string& expr, Iterator begin, Iterator end) const {
 		IndexVector indices;
@@ -0,0 +1,490 @@
+/*
+ * calc/rhs_kernel.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_RHS_KERNEL_HPP_
+#define CALC_RHS_KERNEL_HPP_
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include <gsl/gsl_errno.h>
+#include "network.hpp"
+#include "incidence.hpp"
+#include "contact_kernel.hpp"
+#include "field_drive.hpp"
+#include "implicit_system.hpp"
+#include "bicgstab.hpp"
+#include "../util/thread_pool.hpp"
+
+/*
+ * Right-hand side of the ODE system.
+ * Works on a snapshot of contact parameters taken before the run and on
+ * the state vector passed by the solver, so that every stage of a
+ * Runge-Kutta step sees consistent phases. Parameters divided by beta and
+ * field drives are computed by setup(), so the contact loop has neither
+ * divisions nor dot products; the snapshot is retaken only when contact
+ * parameters change.
+ *
+ * Phases and voltages are kept in separate halves of the state vector,
+ * so the contact loop runs over contiguous arrays and is vectorized by
+ * ContactKernel.
+ *
+ * When a thread pool is given, circuits and contacts are split into
+ * blocks of fixed size which are evaluated in parallel. Every element is
+ * calculated by the same code irrespective of the block it falls in, so
+ * results are bitwise identical for any number of threads.
+ *
+ * Linear systems of implicit methods are reduced to contact voltages and
+ * solved by BiCGSTAB using the incidence matrix, see solveReduced().
+ *
+ * Several networks sharing the same topology can be evaluated at once as
+ * an ensemble. Their values are interleaved as lanes, value of k-th
+ * network for i-th contact is stored at i * lanes + k, so the topology is
+ * traversed once for all networks and the contact loop stays contiguous.
+ * Each lane is calculated exactly as a single network would be.
+ *
+ * Time-dependent fields are given as FieldDrive objects. Their waveforms
+ * are evaluated once per call and added to static field drives over
+ * precomputed sets of contacts.
+ *
+ * Phases of the state vector may have whole turns removed, they are
+ * accounted in circuit phases by setWindings(), so the system stays the
+ * same. Integrator wraps phases into [-pi, pi) at time points, so sine is
+ * evaluated on arguments off that range by no more than the advance of
+ * phase between two time points.
+ */
+class RhsKernel : public ImplicitSystem {
+public:
+
+	typedef std::vector<const Network*> NetworkVector;
+
+	// maximum number of networks in ensemble
+	static const std::size_t maxLanes = 256;
+
+	RhsKernel() : incidence(0), pool(0), numOfContacts(0), numOfLanes(1), linearA2(0.0), fields(0), phi(0), u(0), du(0), cp(0), nonlinearOnly(false) {}
+
+	/*
+	 * Sets thread pool used for evaluation, null means serial evaluation.
+	 */
+	void setThreadPool(ThreadPool* const pool) {
+		this->pool = pool;
+	}
+
+	void setContactKernel(const ContactKernel& contactKernel) {
+		this->contactKernel = contactKernel;
+	}
+
+	const ContactKernel& getContactKernel() const {
+		return contactKernel;
+	}
+
+	void setup(const Network& network, const Incidence& incidence) {
+		setup(NetworkVector(1, &network), incidence);
+	}
+
+	/*
+	 * All networks must have topology described by incidence.
+	 */
+	void setup(const NetworkVector& networks, const Incidence& incidence) {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+
+		if (networks.empty() || networks.size() > maxLanes) {
+			throw std::invalid_argument("wrong number of networks in ensemble");
+		}
+
+		this->incidence = &incidence;
+		numOfContacts = incidence.getNumOfContacts();
+		numOfLanes = networks.size();
+
+		const std::size_t size = numOfContacts * numOfLanes;
+		betas.resize(size);
+		taus.resize(size);
+		vs.resize(size);
+		invBetas.resize(size);
+		tauBetas.resize(size);
+		vBetas.resize(size);
+		fieldDrives.resize(size);
+		couplingDiagonal.resize(size);
+
+		Network::ValueVector diagonal(numOfContacts);
+		incidence.couplingDiagonal(diagonal.empty() ? 0 : &diagonal[0]);
+
+		for (std::size_t k = 0; k < numOfLanes; ++k) {
+			const Network& network = *networks[k];
+			for (std::size_t i = 0, j = k; i < numOfContacts; ++i, j += numOfLanes) {
+				betas[j] = network.getBeta(i);
+				taus[j] = network.getTau(i);
+				vs[j] = network.getV(i);
+				invBetas[j] = 1.0 / betas[j];
+				tauBetas[j] = taus[j] / betas[j];
+				vBetas[j] = vs[j] / betas[j];
+				fieldDrives[j] = - twoPi * (network.getH(i) * network.getHNormal(i));
+				couplingDiagonal[j] = diagonal[i];
+			}
+		}
+
+		circuitPhases.resize(incidence.getNumOfCircuits() * numOfLanes);
+		windingPhases.clear();
+		drives.clear();
+	}
+
+	/*
+	 * Adds time-dependent field to contacts of networks selected by tag
+	 * expression of the drive. Networks must be those of setup().
+	 */
+	void addDrive(const FieldDrive& drive, const NetworkVector& networks) {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+
+		DriveTerm term;
+		term.drive = &drive;
+		for (std::size_t k = 0; k < networks.size(); ++k) {
+			const Network& network = *networks[k];
+			const Network::IndexVector indices = network.buildContactIndices(drive.getParams().tagExpr);
+			for (Network::IndexVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
+				term.slots.push_back(*i * numOfLanes + k);
+				term.coefficients.push_back(- twoPi * (drive.getParams().amplitude * network.getHNormal(*i)));
+			}
+		}
+
+		drives.push_back(term);
+	}
+
+	void clearDrives() {
+		drives.clear();
+	}
+
+	/*
+	 * Sets number of whole turns for every value of the state vector,
+	 * windings are laid out as phases.
+	 */
+	void setWindings(const long* const windings) {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+
+		const std::size_t n = numOfContacts * numOfLanes;
+		windingPhases.clear();
+		if (std::count(windings, windings + n, 0L) == static_cast<std::ptrdiff_t>(n)) {
+			return;
+		}
+
+		Network::ValueVector turns(n);
+		for (std::size_t i = 0; i < n; ++i) {
+			turns[i] = twoPi * windings[i];
+		}
+
+		windingPhases.resize(circuitPhases.size());
+		incidence->circuitPhases(&turns[0], &windingPhases[0], 0, incidence->getNumOfCircuits(), numOfLanes);
+	}
+
+	std::size_t getNumOfLanes() const {
+		return numOfLanes;
+	}
+
+	/*
+	 * y[i]     : phi(t)
+	 * y[n + i] : u(t)
+	 * f[i]     : d(phi)/dt
+	 * f[n + i] : d(u)/dt
+	 * where n is number of contacts times number of lanes
+	 */
+	void evaluate(double const t, const double y[], double f[]) {
+		const std::size_t n = numOfContacts * numOfLanes;
+		fields = fieldsAt(t);
+		phi = y;
+		u = y + n;
+		du = f + n;
+		cp = circuitPhases.empty() ? 0 : &circuitPhases[0];
+		nonlinearOnly = false;
+
+		CircuitTask circuitTask(*this);
+		ContactTask contactTask(*this);
+		const std::size_t numOfCircuits = incidence->getNumOfCircuits();
+		if (pool) {
+			pool->run(circuitTask, numOfCircuits, block());
+			pool->run(contactTask, numOfContacts, block());
+		} else {
+			circuitTask(0, numOfCircuits);
+			contactTask(0, numOfContacts);
+		}
+
+		memcpy(f, u, n * sizeof(double));
+	}
+
+	/*
+	 * Linear part of the system is
+	 *     | 0         I       |
+	 * A = |                   |
+	 *     | -B^-1 L   -B^-1 T |
+	 * the rest is
+	 * N[i]     = 0
+	 * N[n + i] = 1 / beta[i] * (-2 pi h[i](t) * hNormal[i] - v[i] sin(phi[i]) - (L 2 pi w)[i])
+	 * where w are windings, L acts on wrapped phases only.
+	 */
+	virtual int evaluateNonlinear(double const t, const double y[], double f[]) {
+		const std::size_t n = numOfContacts * numOfLanes;
+		fields = fieldsAt(t);
+		phi = y;
+		u = 0;
+		du = f + n;
+		cp = 0;
+		nonlinearOnly = true;
+
+		ContactTask contactTask(*this);
+		if (pool) {
+			pool->run(contactTask, numOfContacts, block());
+		} else {
+			contactTask(0, numOfContacts);
+		}
+
+		std::fill(f, f + n, 0.0);
+		return GSL_SUCCESS;
+	}
+
+	/*
+	 * Jacobian of the system is
+	 *     | 0                     I         |
+	 * J = |                                 |
+	 *     | -B^-1 (V cos(phi) + L)  -B^-1 T |
+	 * where B, T, V are diagonal matrices of beta, tau, v and L is the
+	 * circuit coupling operator.
+	 */
+	virtual int solve(double const /* t */, const double y[], double const a, const double r[], double k[]) {
+		return solveReduced(y, a, r, k);
+	}
+
+	virtual int solveLinear(double const a, const double r[], double k[]) {
+		return solveReduced(0, a, r, k);
+	}
+
+private:
+
+	// values are processed in chunks small enough to keep drives in L1 cache
+	static const std::size_t chunkSize = maxLanes;
+
+	// number of values handed to a thread at once
+	static const std::size_t blockSize = 8 * chunkSize;
+
+	// number of contacts or circuits in chunk and block
+	std::size_t chunk() const {
+		return chunkSize / numOfLanes;
+	}
+
+	std::size_t block() const {
+		return blockSize / numOfLanes;
+	}
+
+	struct CircuitTask : public ThreadPool::Task {
+
+		RhsKernel& kernel;
+
+		CircuitTask(RhsKernel& kernel) : kernel(kernel) {}
+
+		virtual void operator()(std::size_t const first, std::size_t const last) {
+			const std::size_t lanes = kernel.numOfLanes;
+			kernel.incidence->circuitPhases(kernel.phi, kernel.cp, first, last, lanes);
+
+			if (!kernel.windingPhases.empty()) {
+				for (std::size_t j = first * lanes; j < last * lanes; ++j) {
+					kernel.cp[j] += kernel.windingPhases[j];
+				}
+			}
+		}
+
+	};
+
+	struct ContactTask : public ThreadPool::Task {
+
+		RhsKernel& kernel;
+
+		ContactTask(RhsKernel& kernel) : kernel(kernel) {}
+
+		virtual void operator()(std::size_t const first, std::size_t const last) {
+			const std::size_t chunk = kernel.chunk();
+			for (std::size_t i = first; i < last; i += chunk) {
+				kernel.evaluateContacts(i, std::min(last, i + chunk));
+			}
+		}
+
+	};
+
+	// x -> (B + a T + a^2 V cos(phi)) x + a^2 L x
+	struct LinearOperator {
+
+		RhsKernel& kernel;
+
+		LinearOperator(RhsKernel& kernel) : kernel(kernel) {}
+
+		void operator()(const double* const x, double* const dest) const {
+			double* const cp = kernel.circuitPhases.empty() ? 0 : &kernel.circuitPhases[0];
+			kernel.incidence->couple(x, cp, dest, kernel.numOfLanes);
+			for (std::size_t i = 0, n = kernel.numOfContacts * kernel.numOfLanes; i < n; ++i) {
+				dest[i] = kernel.linearDiagonal[i] * x[i] + kernel.linearA2 * dest[i];
+			}
+		}
+
+	};
+
+	struct JacobiPreconditioner {
+
+		RhsKernel& kernel;
+
+		JacobiPreconditioner(RhsKernel& kernel) : kernel(kernel) {}
+
+		void operator()(const double* const x, double* const dest) const {
+			for (std::size_t i = 0, n = kernel.numOfContacts * kernel.numOfLanes; i < n; ++i) {
+				dest[i] = kernel.preconditioner[i] * x[i];
+			}
+		}
+
+	};
+
+	const Incidence* incidence;
+	ThreadPool* pool;
+	ContactKernel contactKernel;
+	std::size_t numOfContacts, numOfLanes;
+	Network::ValueVector betas, taus, vs;
+	Network::ValueVector invBetas, tauBetas, vBetas;	// 1 / beta, tau / beta, v / beta
+	Network::ValueVector fieldDrives;	// -2 pi h * hNormal
+
+	// time-dependent field, values of slots are incremented by coefficients times waveform
+	struct DriveTerm {
+		const FieldDrive* drive;
+		std::vector<std::size_t> slots;
+		Network::ValueVector coefficients;
+	};
+
+	std::vector<DriveTerm> drives;
+	Network::ValueVector timeFields;	// field drives at time of current evaluation
+	Network::ValueVector circuitPhases;
+	Network::ValueVector windingPhases;	// contribution of whole turns, empty if there are none
+
+	// implicit solution
+	Network::ValueVector couplingDiagonal, linearDiagonal, preconditioner, linearRhs, vCos;
+	double linearA2;
+	BiCgStab linearSolver;
+
+	// arguments of current evaluation
+	const double* fields;
+	const double* phi;
+	const double* u;
+	double* du;
+	double* cp;
+	bool nonlinearOnly;
+
+	// field drives at time t, static ones plus waveforms of time-dependent drives
+	const double* fieldsAt(double const t) {
+		if (drives.empty()) {
+			return fieldDrives.empty() ? 0 : &fieldDrives[0];
+		}
+
+		timeFields = fieldDrives;
+		for (std::vector<DriveTerm>::const_iterator d = drives.begin(), last = drives.end(); d != last; ++d) {
+			const double w = d->drive->waveform(t);
+			if (0.0 != w) {
+				for (std::size_t j = 0, n = d->slots.size(); j < n; ++j) {
+					timeFields[d->slots[j]] += w * d->coefficients[j];
+				}
+			}
+		}
+
+		return timeFields.empty() ? 0 : &timeFields[0];
+	}
+
+	/*
+	 * Eliminating phases from (I - a J) k = r gives system of contact size
+	 * (B + a T + a^2 (C + L)) k_u = B r_u - a (C + L) r_phi,
+	 * k_phi = r_phi + a k_u,
+	 * where C = V cos(phi) for full Jacobian and C = 0 for the linear part
+	 * (y is null).
+	 */
+	int solveReduced(const double y[], double const a, const double r[], double k[]) {
+		const std::size_t n = numOfContacts * numOfLanes;
+		const double* const rPhi = r;
+		const double* const rU = r + n;
+
+		linearDiagonal.resize(n);
+		preconditioner.resize(n);
+		linearRhs.resize(n);
+		vCos.resize(n);
+		if (0 == n) {
+			return GSL_SUCCESS;
+		}
+
+		double* const cp = circuitPhases.empty() ? 0 : &circuitPhases[0];
+		double* const lr = &linearRhs[0];
+		incidence->couple(rPhi, cp, lr, numOfLanes);
+
+		linearA2 = a * a;
+		for (std::size_t i = 0; i < n; ++i) {
+			vCos[i] = y ? vs[i] * cos(y[i]) : 0.0;
+			linearRhs[i] = betas[i] * rU[i] - a * (vCos[i] * rPhi[i] + lr[i]);
+			linearDiagonal[i] = betas[i] + a * taus[i] + linearA2 * vCos[i];
+			preconditioner[i] = 1.0 / (linearDiagonal[i] + linearA2 * couplingDiagonal[i]);
+			k[n + i] = linearRhs[i] * preconditioner[i];
+		}
+
+		LinearOperator op(*this);
+		JacobiPreconditioner precond(*this);
+		if (!linearSolver.solve(n, op, precond, &linearRhs[0], k + n)) {
+			return GSL_FAILURE;
+		}
+
+		for (std::size_t i = 0; i < n; ++i) {
+			k[i] = rPhi[i] + a * k[n + i];
+		}
+
+		return GSL_SUCCESS;
+	}
+
+	void evaluateContacts(std::size_t const first, std::size_t const last) const {
+		const static double zeros[chunkSize] = {0.0};
+
+		const std::size_t lanes = numOfLanes;
+		const std::size_t begin = first * lanes, end = last * lanes;
+		const double* const field = fields + begin;
+
+		// nonlinear part keeps feedback of whole turns, which the linear part does not see
+		const double* const coupled = nonlinearOnly ? (windingPhases.empty() ? 0 : &windingPhases[0]) : cp;
+
+		double drive[chunkSize];
+		if (!coupled) {
+			memcpy(drive, field, (end - begin) * sizeof(double));
+		} else if (1 == lanes) {
+			for (std::size_t c = first; c < last; ++c) {
+				drive[c - first] = field[c - first] - incidence->feedback(c, coupled);
+			}
+		} else {
+			for (std::size_t c = first; c < last; ++c) {
+				incidence->feedback(c, coupled, lanes, drive + (c - first) * lanes);
+			}
+			for (std::size_t j = 0; j < end - begin; ++j) {
+				drive[j] = field[j] - drive[j];
+			}
+		}
+
+		// damping term is linear, it vanishes with zero voltages
+		contactKernel(
+			end - begin,
+			phi + begin,
+			nonlinearOnly ? zeros : u + begin,
+			drive,
+			&invBetas[begin],
+			&tauBetas[begin],
+			&vBetas[begin],
+			du + begin);
+	}
+
+};
+
+#endif /* CALC_RHS_KERNEL_HPP_ */
@@ -0,0 +1,167 @@
+/*
+ * calc/rosenbrock.cpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include <string.h>
+#include <vector>
+#include <gsl/gsl_errno.h>
+#include "rosenbrock.hpp"
+#include "step_point.hpp"
+
+namespace {
+
+	const double gamma = 1.0 + 0.70710678118654752440;
+
+	/*
+	 * (I - gamma h J) k1 = f(y)
+	 * (I - gamma h J) k2 = f(y + h k1) - 2 k1
+	 * y' = y + 3/2 h k1 + 1/2 h k2
+	 * error is the difference with y + h k1
+	 */
+	struct State : public ImplicitStepState {
+
+		std::vector<double> k1, k2, f, ytmp;
+
+		// start and end of the last step
+		StepPoint start, end;
+
+		explicit State(std::size_t const dim) : k1(dim), k2(dim), f(dim), ytmp(dim), start(dim), end(dim) {}
+
+	};
+
+	State& state(void* const vstate) {
+		return *static_cast<State*>(static_cast<ImplicitStepState*>(vstate));
+	}
+
+	void* ros2Alloc(size_t const dim) {
+		try {
+			return static_cast<ImplicitStepState*>(new State(dim));
+		} catch (...) {
+			return 0;
+		}
+	}
+
+	int ros2Apply(
+			void* const vstate,
+			size_t const dim,
+			double const t,
+			double const h,
+			double y[],
+			double yerr[],
+			const double dydt_in[],
+			double dydt_out[],
+			const gsl_odeiv2_system* const sys) {
+
+		State& s = state(vstate);
+		if (!s.system) {
+			return GSL_EINVAL;
+		}
+
+		double* const k1 = &s.k1[0];
+		double* const k2 = &s.k2[0];
+		double* const f = &s.f[0];
+		double* const ytmp = &s.ytmp[0];
+		const double a = gamma * h;
+
+		int status = GSL_SUCCESS;
+		if (dydt_in) {
+			memcpy(f, dydt_in, dim * sizeof(double));
+		} else if (s.end.matches(t, y)) {
+			memcpy(f, &s.end.dydt[0], dim * sizeof(double));
+		} else if (s.start.matches(t, y)) {
+			memcpy(f, &s.start.dydt[0], dim * sizeof(double));
+		} else {
+			status = GSL_ODEIV_FN_EVAL(sys, t, y, f);
+		}
+
+		if (GSL_SUCCESS != status) {
+			return status;
+		}
+
+		s.start.assign(t, y, f);
+		s.end.valid = false;
+
+		status = s.system->solve(t, y, a, f, k1);
+
+		if (GSL_SUCCESS == status) {
+			for (size_t i = 0; i < dim; ++i) {
+				ytmp[i] = y[i] + h * k1[i];
+			}
+			status = GSL_ODEIV_FN_EVAL(sys, t + h, ytmp, f);
+		}
+
+		if (GSL_SUCCESS == status) {
+			for (size_t i = 0; i < dim; ++i) {
+				f[i] -= 2.0 * k1[i];
+			}
+			status = s.system->solve(t, y, a, f, k2);
+		}
+
+		if (GSL_SUCCESS != status) {
+			return status;
+		}
+
+		for (size_t i = 0; i < dim; ++i) {
+			ytmp[i] = y[i] + h * (1.5 * k1[i] + 0.5 * k2[i]);
+			yerr[i] = 0.5 * h * (k1[i] + k2[i]);
+		}
+
+		// derivative at the end is needed by the next step anyway
+		status = GSL_ODEIV_FN_EVAL(sys, t + h, ytmp, f);
+		if (GSL_SUCCESS != status) {
+			return status;
+		}
+
+		memcpy(y, ytmp, dim * sizeof(double));
+		s.end.assign(t + h, y, f);
+
+		if (dydt_out) {
+			memcpy(dydt_out, f, dim * sizeof(double));
+		}
+
+		return GSL_SUCCESS;
+	}
+
+	int ros2SetDriver(void* /* vstate */, const gsl_odeiv2_driver* /* d */) {
+		return GSL_SUCCESS;
+	}
+
+	int ros2Reset(void* const vstate, size_t /* dim */) {
+		State& s = state(vstate);
+		s.start.valid = false;
+		s.end.valid = false;
+		return GSL_SUCCESS;
+	}
+
+	unsigned int ros2Order(void* /* vstate */) {
+		return 2;
+	}
+
+	void ros2Free(void* const vstate) {
+		delete &state(vstate);
+	}
+
+	const gsl_odeiv2_step_type ros2Type = {
+		"ros2",
+		0,	// derivative at the start is cached by the method itself
+		1,	// gives exact dydt_out
+		&ros2Alloc,
+		&ros2Apply,
+		&ros2SetDriver,
+		&ros2Reset,
+		&ros2Order,
+		&ros2Free
+	};
+
+}
+
+const gsl_odeiv2_step_type* const ros2StepType = &ros2Type;
@@ -0,0 +1,30 @@
+/*
+ * calc/rosenbrock.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_ROSENBROCK_HPP_
+#define CALC_ROSENBROCK_HPP_
+
+#include <gsl/gsl_odeiv2.h>
+#include "implicit_system.hpp"
+
+/*
+ * Two-stage L-stable Rosenbrock method ROS2 with gamma = 1 + 1/sqrt(2)
+ * (Verwer et al, 1999) and embedded first order solution for step size
+ * control. Linear systems are solved by ImplicitSystem which must be
+ * attached to the step by setImplicitSystem() before use. The method
+ * keeps second order for approximate Jacobians, so iterative solution of
+ * linear systems does not spoil it.
+ */
+extern const gsl_odeiv2_step_type* const ros2StepType;
+
+#endif /* CALC_ROSENBROCK_HPP_ */
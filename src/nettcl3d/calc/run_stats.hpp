@@ -0,0 +1,124 @@
+/*
+ * calc/run_stats.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_RUN_STATS_HPP_
+#define CALC_RUN_STATS_HPP_
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <string>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+/*
+ * Counters and timings collected by integrator during a run.
+ * Wall time of the run is split into time spent evaluating right hand
+ * side (its nonlinear part for IMEX methods included), solving linear
+ * systems of implicit and IMEX methods, the rest of solver time (step
+ * control, GSL bookkeeping), tracers and everything else (setup, phase
+ * wrapping, checkpoints, event detection). Times are in seconds.
+ */
+struct RunStats {
+
+	class Stopwatch {
+	public:
+
+		Stopwatch() : start(now()) {}
+
+		double elapsed() const {
+			return (now() - start).total_microseconds() * 1.0e-6;
+		}
+
+	private:
+
+		boost::posix_time::ptime start;
+
+		static boost::posix_time::ptime now() {
+			return boost::posix_time::microsec_clock::universal_time();
+		}
+
+	};
+
+	unsigned long rhsEvaluations;
+	unsigned long acceptedSteps, rejectedSteps;
+	unsigned long timePoints;
+	double minStep, maxStep, sumOfSteps;
+	double wallTime, rhsTime, linearSolveTime, solverTime, tracerTime;
+
+	RunStats() :
+		rhsEvaluations(0),
+		acceptedSteps(0),
+		rejectedSteps(0),
+		timePoints(0),
+		minStep(0.0),
+		maxStep(0.0),
+		sumOfSteps(0.0),
+		wallTime(0.0),
+		rhsTime(0.0),
+		linearSolveTime(0.0),
+		solverTime(0.0),
+		tracerTime(0.0)
+	{}
+
+	void addStep(double const h) {
+		minStep = acceptedSteps ? std::min(minStep, h) : h;
+		maxStep = acceptedSteps ? std::max(maxStep, h) : h;
+		sumOfSteps += h;
+		++acceptedSteps;
+	}
+
+	double meanStep() const {
+		return acceptedSteps ? sumOfSteps / acceptedSteps : 0.0;
+	}
+
+	// solver time besides evaluation of right hand side and linear solves
+	double overheadTime() const {
+		return std::max(0.0, solverTime - rhsTime - linearSolveTime);
+	}
+
+	double otherTime() const {
+		return std::max(0.0, wallTime - solverTime - tracerTime);
+	}
+
+	void save(const std::string& fileName) const {
+		std::ofstream s(fileName.c_str(), std::ios::out | std::ios::trunc);
+		if (!s) {
+			throw std::runtime_error("cannot create file " + fileName);
+		}
+
+		s << std::setprecision(15)
+			<< "{\n"
+			<< "\t\"rhsEvaluations\": " << rhsEvaluations << ",\n"
+			<< "\t\"acceptedSteps\": " << acceptedSteps << ",\n"
+			<< "\t\"rejectedSteps\": " << rejectedSteps << ",\n"
+			<< "\t\"timePoints\": " << timePoints << ",\n"
+			<< "\t\"minStep\": " << minStep << ",\n"
+			<< "\t\"maxStep\": " << maxStep << ",\n"
+			<< "\t\"meanStep\": " << meanStep() << ",\n"
+			<< "\t\"wallTime\": " << wallTime << ",\n"
+			<< "\t\"rhsTime\": " << rhsTime << ",\n"
+			<< "\t\"linearSolveTime\": " << linearSolveTime << ",\n"
+			<< "\t\"solverOverheadTime\": " << overheadTime() << ",\n"
+			<< "\t\"tracerTime\": " << tracerTime << ",\n"
+			<< "\t\"otherTime\": " << otherTime() << "\n"
+			<< "}\n";
+
+		if (!s) {
+			throw std::runtime_error("error writing file " + fileName);
+		}
+	}
+
+};
+
+#endif /* CALC_RUN_STATS_HPP_ */
@@ -0,0 +1,122 @@
+/*
+ * calc/steady_state.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_STEADY_STATE_HPP_
+#define CALC_STEADY_STATE_HPP_
+
+#include <math.h>
+#include <algorithm>
+
+/*
+ * Detects steady state of a run from samples of mean voltage and mean
+ * flux taken at time points. Samples are collected in consecutive windows
+ * of given length, the state is steady once mean and standard deviation
+ * of both values in a window differ from those of the previous window by
+ * no more than tolerance. Deviation is compared too, so that oscillating
+ * states driven by AC field converge as well.
+ */
+class SteadyState {
+public:
+
+	SteadyState() : window(0.0), tolerance(0.0) {
+		reset(0.0);
+	}
+
+	SteadyState(double const window, double const tolerance) : window(window), tolerance(tolerance) {
+		reset(0.0);
+	}
+
+	void reset(double const startTime) {
+		windowStart = startTime;
+		convergenceTime = -1.0;
+		hasPrevious = false;
+		voltage.clear();
+		flux.clear();
+	}
+
+	/*
+	 * Returns true once the state is steady.
+	 */
+	bool sample(double const time, double const meanVoltage, double const meanFlux) {
+		if (convergenceTime >= 0.0) {
+			return true;
+		}
+
+		voltage.add(meanVoltage);
+		flux.add(meanFlux);
+
+		if (time < windowStart + window) {
+			return false;
+		}
+
+		if (hasPrevious && voltage.close(prevVoltage, tolerance) && flux.close(prevFlux, tolerance)) {
+			convergenceTime = time;
+			return true;
+		}
+
+		prevVoltage = voltage;
+		prevFlux = flux;
+		hasPrevious = true;
+		voltage.clear();
+		flux.clear();
+		windowStart = time;
+		return false;
+	}
+
+	/*
+	 * Time the state became steady at, negative if it did not.
+	 */
+	double getConvergenceTime() const {
+		return convergenceTime;
+	}
+
+private:
+
+	struct Stats {
+		unsigned long n;
+		double sum, sumSq;
+
+		void clear() {
+			n = 0;
+			sum = sumSq = 0.0;
+		}
+
+		void add(double const v) {
+			++n;
+			sum += v;
+			sumSq += v * v;
+		}
+
+		double mean() const {
+			return n ? sum / n : 0.0;
+		}
+
+		double deviation() const {
+			const double m = mean();
+			return n ? sqrt(std::max(0.0, sumSq / n - m * m)) : 0.0;
+		}
+
+		bool close(const Stats& other, double const tolerance) const {
+			return fabs(mean() - other.mean()) <= tolerance
+				&& fabs(deviation() - other.deviation()) <= tolerance;
+		}
+	};
+
+	double window, tolerance;
+	double windowStart, convergenceTime;
+	bool hasPrevious;
+	Stats voltage, flux, prevVoltage, prevFlux;
+
+};
+
+#endif /* CALC_STEADY_STATE_HPP_ */
@@ -0,0 +1,47 @@
+/*
+ * calc/step_point.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_STEP_POINT_HPP_
+#define CALC_STEP_POINT_HPP_
+
+#include <string.h>
+#include <vector>
+
+/*
+ * State vector and its derivative at some point of time.
+ * GSL evolve does not pass derivative at the end of a step to the next
+ * one, so step types remember it themselves to save RHS evaluation.
+ */
+struct StepPoint {
+
+	std::vector<double> y, dydt;
+	double t;
+	bool valid;
+
+	explicit StepPoint(std::size_t const dim) : y(dim), dydt(dim), t(0.0), valid(false) {}
+
+	bool matches(double const t, const double y[]) const {
+		return valid && t == this->t && 0 == memcmp(&this->y[0], y, this->y.size() * sizeof(double));
+	}
+
+	void assign(double const t, const double y[], const double dydt[]) {
+		const std::size_t size = this->y.size() * sizeof(double);
+		memcpy(&this->y[0], y, size);
+		memcpy(&this->dydt[0], dydt, size);
+		this->t = t;
+		valid = true;
+	}
+
+};
+
+#endif /* CALC_STEP_POINT_HPP_ */
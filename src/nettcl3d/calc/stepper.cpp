@@ -0,0 +1,81 @@
+/*
+ * calc/stepper.cpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include "stepper.hpp"
+#include "dopri5.hpp"
+#include "rosenbrock.hpp"
+#include "imex.hpp"
+
+namespace {
+
+	// types are referenced indirectly as they are initialized in other units
+	struct Entry {
+		const char* name;
+		const gsl_odeiv2_step_type* const* type;
+		bool implicit;
+	};
+
+	const Entry entries[] = {
+		{"rk2", &gsl_odeiv2_step_rk2, false},
+		{"rk4", &gsl_odeiv2_step_rk4, false},
+		{"rkf45", &gsl_odeiv2_step_rkf45, false},
+		{"rkck", &gsl_odeiv2_step_rkck, false},
+		{"rk8pd", &gsl_odeiv2_step_rk8pd, false},
+		{"dopri5", &dopri5StepType, false},
+		{"msadams", &gsl_odeiv2_step_msadams, false},
+		{"ros2", &ros2StepType, true},
+		{"imex", &imexStepType, true}
+	};
+
+	const std::size_t numOfEntries = sizeof(entries) / sizeof(*entries);
+
+	const Entry* findEntry(const std::string& name) {
+		for (std::size_t i = 0; i < numOfEntries; ++i) {
+			if (name == entries[i].name) {
+				return &entries[i];
+			}
+		}
+
+		return 0;
+	}
+
+}
+
+Stepper::Stepper(const std::string& name) :
+	name(name) {
+
+	const Entry* const entry = findEntry(name);
+	if (!entry) {
+		throw UnknownStepper(name);
+	}
+
+	type = *entry->type;
+	implicit = entry->implicit;
+}
+
+bool Stepper::isSupported(const std::string& name) {
+	return findEntry(name) != 0;
+}
+
+std::string Stepper::names() {
+	std::string result;
+
+	for (std::size_t i = 0; i < numOfEntries; ++i) {
+		if (i > 0) {
+			result += " | ";
+		}
+		result += entries[i].name;
+	}
+
+	return result;
+}
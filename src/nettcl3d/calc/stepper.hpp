@@ -0,0 +1,72 @@
+/*
+ * calc/stepper.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_STEPPER_HPP_
+#define CALC_STEPPER_HPP_
+
+#include <string>
+#include <stdexcept>
+#include <gsl/gsl_odeiv2.h>
+
+/*
+ * ODE stepping method selected by name.
+ * Explicit GSL steppers are available along with Dormand-Prince 5(4).
+ * GSL implicit methods need dense Jacobian and are not, the Rosenbrock
+ * and IMEX methods use ImplicitSystem instead.
+ */
+class Stepper {
+public:
+
+	struct UnknownStepper : public std::invalid_argument {
+
+		UnknownStepper(const std::string& name) : std::invalid_argument("unknown stepper: " + name) {}
+
+	};
+
+	/*
+	 * Selects method by name: rk2, rk4, rkf45, rkck, rk8pd, dopri5, msadams,
+	 * ros2 or imex.
+	 */
+	explicit Stepper(const std::string& name = "rkf45");
+
+	const gsl_odeiv2_step_type* getType() const {
+		return type;
+	}
+
+	const std::string& getName() const {
+		return name;
+	}
+
+	/*
+	 * Implicit methods need ImplicitSystem attached to the step.
+	 */
+	bool isImplicit() const {
+		return implicit;
+	}
+
+	static bool isSupported(const std::string& name);
+
+	/*
+	 * Names of all methods separated by " | ".
+	 */
+	static std::string names();
+
+private:
+
+	std::string name;
+	const gsl_odeiv2_step_type* type;
+	bool implicit;
+
+};
+
+#endif /* CALC_STEPPER_HPP_ */
@@ -0,0 +1,194 @@
+/*
+ * calc/sweep.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_SWEEP_HPP_
+#define CALC_SWEEP_HPP_
+
+#include <math.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "network.hpp"
+#include "integrator.hpp"
+
+/*
+ * Sweeps a component of external field over a range of values.
+ * Every point starts from the state left by the previous one: the network
+ * is settled for settleTime, then mean voltage and flux are measured for
+ * measureTime. With hysteresis the range is passed back to the start.
+ * Swept value is added to the field every contact had before the sweep,
+ * so that disorder of the field is kept, and the field is restored when
+ * the sweep ends.
+ */
+class Sweep {
+public:
+
+	typedef enum {HX, HY, HZ} Parameter;
+
+	struct Params {
+		Parameter parameter;
+		double from, to, step;
+		double settleTime, measureTime;
+		double dt;	// flux sampling interval
+		bool hysteresis;
+
+		Params() :
+			parameter(HX),
+			from(0.0), to(0.0), step(1.0),
+			settleTime(0.0), measureTime(1.0),
+			dt(0.1),
+			hysteresis(false)
+		{}
+	};
+
+	struct Result {
+		double value;
+		double voltage;	// mean over contacts and measuring time
+		double flux;	// mean over circuits and samples
+	};
+
+	typedef std::vector<Result> ResultVector;
+
+	Sweep(Integrator& integrator, const Params& params) : integrator(integrator), params(params) {
+		validate(params);
+	}
+
+	static void validate(const Params& params) {
+		if (0.0 == params.step || (params.to - params.from) / params.step < 0.0) {
+			throw std::invalid_argument("step does not lead from start to end of the range");
+		}
+
+		if (params.settleTime < 0.0 || params.measureTime <= 0.0 || params.dt <= 0.0) {
+			throw std::invalid_argument("times must be positive");
+		}
+	}
+
+	static std::vector<double> values(const Params& params) {
+		const std::size_t n = static_cast<std::size_t>(floor((params.to - params.from) / params.step + 1.0e-9)) + 1;
+
+		std::vector<double> result;
+		result.reserve(params.hysteresis ? 2 * n - 1 : n);
+		for (std::size_t i = 0; i < n; ++i) {
+			result.push_back(params.from + i * params.step);
+		}
+
+		if (params.hysteresis) {
+			for (std::size_t i = n - 1; i-- > 0; ) {
+				result.push_back(result[i]);
+			}
+		}
+
+		return result;
+	}
+
+	ResultVector run(Network& network) {
+		const std::vector<double> points = values(params);
+
+		ResultVector results;
+		results.reserve(points.size());
+
+		const Network::PointVector base = network.getHs();
+		try {
+			sweep(network, base, points, results);
+		} catch (...) {
+			restore(network, base);
+			throw;
+		}
+		restore(network, base);
+
+		return results;
+	}
+
+private:
+
+	Integrator& integrator;
+	const Params params;
+
+	void sweep(Network& network, const Network::PointVector& base, const std::vector<double>& points, ResultVector& results) {
+		const static double twoPi = 2.0 * 3.1415926535897932384626433832795;
+
+		const std::size_t numOfContacts = network.getNumOfContacts();
+		const std::size_t numOfCircuits = network.getNumOfCircuits();
+
+		Network::ValueVector startPhases;
+		Network::WindingVector startWindings;
+		double time = 0.0;
+
+		for (std::vector<double>::const_iterator p = points.begin(), last = points.end(); p != last; ++p) {
+			apply(network, base, *p);
+
+			if (params.settleTime > 0.0) {
+				integrator.advance(network, time, time + params.settleTime);
+				time += params.settleTime;
+			}
+
+			startPhases = network.getPhases();
+			startWindings = network.getWindings();
+
+			// mean voltage is the phase gain over measuring time
+			const double measureEnd = time + params.measureTime;
+			double fluxSum = 0.0;
+			unsigned long samples = 0;
+			for (unsigned long k = 1; time < measureEnd; ++k) {
+				const double next = std::min(measureEnd, time + params.dt);
+				integrator.advance(network, time, next);
+				time = next;
+
+				for (std::size_t c = 0; c < numOfCircuits; ++c) {
+					fluxSum += network.flux(c);
+				}
+				samples = k;
+			}
+
+			const Network::ValueVector& phases = network.getPhases();
+			const Network::WindingVector& windings = network.getWindings();
+			double phaseGain = 0.0;
+			for (std::size_t i = 0; i < numOfContacts; ++i) {
+				phaseGain += phases[i] - startPhases[i] + twoPi * (windings[i] - startWindings[i]);
+			}
+
+			Result r;
+			r.value = *p;
+			r.voltage = numOfContacts > 0 ? phaseGain / numOfContacts / params.measureTime : 0.0;
+			r.flux = numOfCircuits > 0 ? fluxSum / numOfCircuits / samples : 0.0;
+			results.push_back(r);
+		}
+	}
+
+	void apply(Network& network, const Network::PointVector& base, double const value) const {
+		for (std::size_t i = 0, n = base.size(); i < n; ++i) {
+			Point h = base[i];
+			switch (params.parameter) {
+			case HX:
+				h.x += value;
+				break;
+			case HY:
+				h.y += value;
+				break;
+			case HZ:
+				h.z += value;
+				break;
+			}
+			network.setH(i, h);
+		}
+	}
+
+	static void restore(Network& network, const Network::PointVector& base) {
+		for (std::size_t i = 0, n = base.size(); i < n; ++i) {
+			network.setH(i, base[i]);
+		}
+	}
+
+};
+
+#endif /* CALC_SWEEP_HPP_ */
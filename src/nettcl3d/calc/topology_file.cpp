@@ -0,0 +1,478 @@
+/*
+ * calc/topology_file.cpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include "topology_file.hpp"
+
+/*
+ * Layout: header followed by sections listed in Section, every section
+ * starts at offset aligned to 8 bytes. Rows are CSR row pointers,
+ * properties are (name, value) pairs of string indices, string i
+ * occupies [stringOffsets[i], stringOffsets[i + 1]) of strings.
+ */
+
+namespace {
+
+	typedef boost::uint64_t row_type;
+	typedef boost::uint32_t id_type;
+
+	const std::size_t maxId = std::numeric_limits<id_type>::max();
+
+	const char magic[8] = {'N', 'T', '3', 'D', 'T', 'O', 'P', 'O'};
+	const boost::uint32_t byteOrderMark = 0x01020304;
+
+	struct Header {
+		char magic[8];
+		boost::uint32_t version, byteOrderMark;
+		boost::uint64_t numOfContacts, numOfCircuits, numOfRefs;
+		boost::uint64_t numOfStrings, stringBytes;
+		boost::uint64_t numOfContactTags, numOfContactProps;
+		boost::uint64_t numOfCircuitTags, numOfCircuitProps;
+	};
+
+	enum Section {
+		BETAS, TAUS, VS, HS, H_NORMALS, SQUARES, GAINS, WEIGHTS,
+		CIRCUIT_ROWS, STRING_OFFSETS, CONTACT_TAG_ROWS, CONTACT_PROP_ROWS, CIRCUIT_TAG_ROWS, CIRCUIT_PROP_ROWS,
+		REF_CONTACTS, CONTACT_TAGS, CONTACT_PROPS, CIRCUIT_TAGS, CIRCUIT_PROPS,
+		STRINGS,
+		NUM_OF_SECTIONS
+	};
+
+	struct Layout {
+
+		boost::uint64_t sizes[NUM_OF_SECTIONS];
+		boost::uint64_t offsets[NUM_OF_SECTIONS];
+		boost::uint64_t end;
+
+		explicit Layout(const Header& h) {
+			const boost::uint64_t n = h.numOfContacts, c = h.numOfCircuits;
+
+			sizes[BETAS] = sizes[TAUS] = sizes[VS] = n * sizeof(double);
+			sizes[HS] = sizes[H_NORMALS] = 3 * n * sizeof(double);
+			sizes[SQUARES] = c * sizeof(double);
+			sizes[GAINS] = sizes[WEIGHTS] = h.numOfRefs * sizeof(double);
+
+			sizes[CIRCUIT_ROWS] = sizes[CIRCUIT_TAG_ROWS] = sizes[CIRCUIT_PROP_ROWS] = (c + 1) * sizeof(row_type);
+			sizes[CONTACT_TAG_ROWS] = sizes[CONTACT_PROP_ROWS] = (n + 1) * sizeof(row_type);
+			sizes[STRING_OFFSETS] = (h.numOfStrings + 1) * sizeof(row_type);
+
+			sizes[REF_CONTACTS] = h.numOfRefs * sizeof(id_type);
+			sizes[CONTACT_TAGS] = h.numOfContactTags * sizeof(id_type);
+			sizes[CONTACT_PROPS] = 2 * h.numOfContactProps * sizeof(id_type);
+			sizes[CIRCUIT_TAGS] = h.numOfCircuitTags * sizeof(id_type);
+			sizes[CIRCUIT_PROPS] = 2 * h.numOfCircuitProps * sizeof(id_type);
+
+			sizes[STRINGS] = h.stringBytes;
+
+			end = sizeof(Header);
+			for (int i = 0; i < NUM_OF_SECTIONS; ++i) {
+				offsets[i] = end;
+				end = align(end + sizes[i]);
+			}
+		}
+
+		static boost::uint64_t align(boost::uint64_t const offset) {
+			return (offset + 7) & ~static_cast<boost::uint64_t>(7);
+		}
+
+	};
+
+	/*
+	 * Tables of tags and properties of contacts or circuits.
+	 */
+	struct TagTable {
+		std::vector<row_type> tagRows, propRows;
+		std::vector<id_type> tags, props;
+
+		TagTable() : tagRows(1, 0), propRows(1, 0) {}
+	};
+
+	class StringTable {
+	public:
+
+		std::vector<row_type> offsets;
+		std::string chars;
+
+		StringTable() : offsets(1, 0) {}
+
+		id_type intern(const std::string& s) {
+			const std::map<std::string, id_type>::const_iterator i = ids.find(s);
+			if (i != ids.end()) {
+				return i->second;
+			}
+
+			if (offsets.size() - 1 > maxId) {
+				throw std::runtime_error("too many distinct tags and properties for topology file");
+			}
+
+			const id_type id = static_cast<id_type>(offsets.size() - 1);
+			ids[s] = id;
+			chars += s;
+			offsets.push_back(chars.size());
+			return id;
+		}
+
+		void add(const Tagable& t, TagTable& dest) {
+			for (Tagable::TagContainer::const_iterator i = t.tags.begin(), last = t.tags.end(); i != last; ++i) {
+				dest.tags.push_back(intern(*i));
+			}
+			dest.tagRows.push_back(dest.tags.size());
+
+			for (Tagable::PropContainer::const_iterator i = t.props.begin(), last = t.props.end(); i != last; ++i) {
+				dest.props.push_back(intern(i->first));
+				dest.props.push_back(intern(i->second));
+			}
+			dest.propRows.push_back(dest.props.size() / 2);
+		}
+
+	private:
+
+		std::map<std::string, id_type> ids;
+
+	};
+
+	class Writer {
+	public:
+
+		explicit Writer(std::ostream& s) : s(s), offset(0) {}
+
+		void write(const void* const data, boost::uint64_t const size) {
+			s.write(static_cast<const char*>(data), size);
+			offset += size;
+		}
+
+		template <typename T>
+		void section(const std::vector<T>& v) {
+			if (!v.empty()) {
+				write(&v[0], v.size() * sizeof(T));
+			}
+			pad();
+		}
+
+		void section(const std::string& v) {
+			write(v.data(), v.size());
+			pad();
+		}
+
+		void points(const Network::PointVector& v) {
+			for (Network::PointVector::const_iterator i = v.begin(), last = v.end(); i != last; ++i) {
+				const double p[] = {i->x, i->y, i->z};
+				write(p, sizeof(p));
+			}
+			pad();
+		}
+
+	private:
+
+		std::ostream& s;
+		boost::uint64_t offset;
+
+		void pad() {
+			const char zeros[8] = {0};
+			write(zeros, Layout::align(offset) - offset);
+		}
+
+	};
+
+	/*
+	 * Read-only mapping of a file.
+	 */
+	class Mapping : boost::noncopyable {
+	public:
+
+		explicit Mapping(const std::string& fileName) : data(0), size(0) {
+			const int fd = ::open(fileName.c_str(), O_RDONLY);
+			if (fd < 0) {
+				throw std::runtime_error("cannot open file " + fileName);
+			}
+
+			struct stat st;
+			if (::fstat(fd, &st) < 0) {
+				::close(fd);
+				throw std::runtime_error("cannot stat file " + fileName);
+			}
+
+			size = static_cast<std::size_t>(st.st_size);
+			if (size > 0) {
+				void* const p = ::mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+				if (MAP_FAILED == p) {
+					::close(fd);
+					throw std::runtime_error("cannot map file " + fileName);
+				}
+				data = static_cast<const char*>(p);
+			}
+
+			::close(fd);
+		}
+
+		~Mapping() {
+			if (data) {
+				::munmap(const_cast<char*>(data), size);
+			}
+		}
+
+		const char* data;
+		std::size_t size;
+
+	};
+
+	/*
+	 * Typed views of sections of a mapped file.
+	 */
+	class MappedTopology {
+	public:
+
+		explicit MappedTopology(const std::string& fileName) : mapping(new Mapping(fileName)), layout(header()) {
+			check();
+		}
+
+		const Header& header() const {
+			if (mapping->size < sizeof(Header)) {
+				throw TopologyFile::FormatError("file is too short");
+			}
+			return *reinterpret_cast<const Header*>(mapping->data);
+		}
+
+		template <typename T>
+		const T* section(Section const s) const {
+			return reinterpret_cast<const T*>(mapping->data + layout.offsets[s]);
+		}
+
+		std::string string(id_type const id) const {
+			const row_type* const offsets = section<row_type>(STRING_OFFSETS);
+			return std::string(section<char>(STRINGS) + offsets[id], offsets[id + 1] - offsets[id]);
+		}
+
+		void fill(Tagable& dest, std::size_t const index, Section const tagRows, Section const tags, Section const propRows, Section const props) const {
+			const row_type* const tr = section<row_type>(tagRows);
+			const id_type* const t = section<id_type>(tags);
+			for (row_type j = tr[index], end = tr[index + 1]; j < end; ++j) {
+				dest.addTag(string(t[j]));
+			}
+
+			const row_type* const pr = section<row_type>(propRows);
+			const id_type* const p = section<id_type>(props);
+			for (row_type j = pr[index], end = pr[index + 1]; j < end; ++j) {
+				dest.props[string(p[2 * j])] = string(p[2 * j + 1]);
+			}
+		}
+
+	private:
+
+		boost::shared_ptr<Mapping> mapping;
+		const Layout layout;
+
+		void check() const {
+			const Header& h = header();
+
+			if (memcmp(h.magic, magic, sizeof(magic))) {
+				throw TopologyFile::FormatError("not a topology file");
+			}
+			if (h.version != TopologyFile::version) {
+				throw TopologyFile::FormatError("unsupported version");
+			}
+			if (h.byteOrderMark != byteOrderMark) {
+				throw TopologyFile::FormatError("byte order differs");
+			}
+
+			// sizes are checked loosely against overflow first
+			const boost::uint64_t limit = mapping->size;
+			if (h.numOfContacts > limit || h.numOfCircuits > limit || h.numOfRefs > limit
+					|| h.numOfStrings > limit || h.stringBytes > limit
+					|| h.numOfContactTags > limit || h.numOfContactProps > limit
+					|| h.numOfCircuitTags > limit || h.numOfCircuitProps > limit
+					|| layout.end > limit) {
+				throw TopologyFile::FormatError("file is too short");
+			}
+
+			checkRows(CIRCUIT_ROWS, h.numOfCircuits, h.numOfRefs);
+			checkRows(STRING_OFFSETS, h.numOfStrings, h.stringBytes);
+			checkRows(CONTACT_TAG_ROWS, h.numOfContacts, h.numOfContactTags);
+			checkRows(CONTACT_PROP_ROWS, h.numOfContacts, h.numOfContactProps);
+			checkRows(CIRCUIT_TAG_ROWS, h.numOfCircuits, h.numOfCircuitTags);
+			checkRows(CIRCUIT_PROP_ROWS, h.numOfCircuits, h.numOfCircuitProps);
+
+			checkIds(REF_CONTACTS, h.numOfRefs, h.numOfContacts);
+			checkIds(CONTACT_TAGS, h.numOfContactTags, h.numOfStrings);
+			checkIds(CONTACT_PROPS, 2 * h.numOfContactProps, h.numOfStrings);
+			checkIds(CIRCUIT_TAGS, h.numOfCircuitTags, h.numOfStrings);
+			checkIds(CIRCUIT_PROPS, 2 * h.numOfCircuitProps, h.numOfStrings);
+		}
+
+		void checkRows(Section const s, boost::uint64_t const numOfRows, boost::uint64_t const total) const {
+			const row_type* const rows = section<row_type>(s);
+			if (rows[0] != 0 || rows[numOfRows] != total) {
+				throw TopologyFile::FormatError("wrong row pointers");
+			}
+			for (boost::uint64_t i = 0; i < numOfRows; ++i) {
+				if (rows[i] > rows[i + 1]) {
+					throw TopologyFile::FormatError("wrong row pointers");
+				}
+			}
+		}
+
+		void checkIds(Section const s, boost::uint64_t const n, boost::uint64_t const limit) const {
+			const id_type* const ids = section<id_type>(s);
+			for (boost::uint64_t i = 0; i < n; ++i) {
+				if (ids[i] >= limit) {
+					throw TopologyFile::FormatError("index is out of range");
+				}
+			}
+		}
+
+	};
+
+	class MappedTags : public Network::TagSource {
+	public:
+
+		explicit MappedTags(const MappedTopology& topology) : topology(topology) {}
+
+		virtual void fill(Tagable* const dest) const {
+			for (std::size_t i = 0, n = topology.header().numOfContacts; i < n; ++i) {
+				topology.fill(dest[i], i, CONTACT_TAG_ROWS, CONTACT_TAGS, CONTACT_PROP_ROWS, CONTACT_PROPS);
+			}
+		}
+
+	private:
+
+		// keeps file mapped
+		const MappedTopology topology;
+
+	};
+
+}
+
+void TopologyFile::save(const std::string& fileName, const Network& network) {
+	const std::size_t numOfContacts = network.getNumOfContacts();
+	if (numOfContacts > maxId) {
+		throw std::runtime_error("too many contacts for topology file");
+	}
+
+	StringTable strings;
+	TagTable contactTags, circuitTags;
+	for (std::size_t i = 0; i < numOfContacts; ++i) {
+		strings.add(network.contactTagable(i), contactTags);
+	}
+
+	std::vector<row_type> circuitRows(1, 0);
+	std::vector<id_type> refContacts;
+	std::vector<double> gains, weights, squares;
+	for (Network::circuit_const_iterator c = network.circuitBegin(), last = network.circuitEnd(); c != last; ++c) {
+		for (Circuit::const_iterator i = c->begin(), end = c->end(); i != end; ++i) {
+			refContacts.push_back(static_cast<id_type>(i->index));
+			gains.push_back(i->gain);
+			weights.push_back(i->weight);
+		}
+		circuitRows.push_back(refContacts.size());
+		squares.push_back(c->square);
+		strings.add(*c, circuitTags);
+	}
+
+	Header h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, magic, sizeof(magic));
+	h.version = version;
+	h.byteOrderMark = byteOrderMark;
+	h.numOfContacts = numOfContacts;
+	h.numOfCircuits = squares.size();
+	h.numOfRefs = refContacts.size();
+	h.numOfStrings = strings.offsets.size() - 1;
+	h.stringBytes = strings.chars.size();
+	h.numOfContactTags = contactTags.tags.size();
+	h.numOfContactProps = contactTags.props.size() / 2;
+	h.numOfCircuitTags = circuitTags.tags.size();
+	h.numOfCircuitProps = circuitTags.props.size() / 2;
+
+	// written aside and renamed, so that an existing file is never left half written
+	const std::string tempName = fileName + ".tmp";
+	std::ofstream s(tempName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!s) {
+		throw std::runtime_error("cannot create file " + tempName);
+	}
+
+	// order of sections follows Section
+	Writer w(s);
+	w.write(&h, sizeof(h));
+	w.section(network.getBetas());
+	w.section(network.getTaus());
+	w.section(network.getVs());
+	w.points(network.getHs());
+	w.points(network.getHNormals());
+	w.section(squares);
+	w.section(gains);
+	w.section(weights);
+	w.section(circuitRows);
+	w.section(strings.offsets);
+	w.section(contactTags.tagRows);
+	w.section(contactTags.propRows);
+	w.section(circuitTags.tagRows);
+	w.section(circuitTags.propRows);
+	w.section(refContacts);
+	w.section(contactTags.tags);
+	w.section(contactTags.props);
+	w.section(circuitTags.tags);
+	w.section(circuitTags.props);
+	w.section(strings.chars);
+
+	s.close();
+	if (!s) {
+		throw std::runtime_error("error writing file " + tempName);
+	}
+
+	if (::rename(tempName.c_str(), fileName.c_str())) {
+		throw std::runtime_error("cannot rename file " + tempName);
+	}
+}
+
+void TopologyFile::load(const std::string& fileName, Network& network) {
+	const MappedTopology topology(fileName);
+	const Header& h = topology.header();
+	const std::size_t first = network.getNumOfContacts();
+
+	network.addContacts(
+		h.numOfContacts,
+		topology.section<double>(BETAS),
+		topology.section<double>(TAUS),
+		topology.section<double>(VS),
+		topology.section<double>(HS),
+		topology.section<double>(H_NORMALS),
+		Network::TagSourcePtr(new MappedTags(topology)));
+
+	const row_type* const rows = topology.section<row_type>(CIRCUIT_ROWS);
+	const id_type* const refContacts = topology.section<id_type>(REF_CONTACTS);
+	const double* const gains = topology.section<double>(GAINS);
+	const double* const weights = topology.section<double>(WEIGHTS);
+	const double* const squares = topology.section<double>(SQUARES);
+
+	// circuits are filled in place to avoid copying of tags
+	network.reserveCircuits(network.getNumOfCircuits() + h.numOfCircuits);
+	for (std::size_t c = 0; c < h.numOfCircuits; ++c) {
+		Circuit& circuit = network.circuit(network.addCircuit(Circuit(squares[c])));
+		circuit.contactRefs.reserve(rows[c + 1] - rows[c]);
+		for (row_type j = rows[c], end = rows[c + 1]; j < end; ++j) {
+			circuit.addContactRef(ContactRef(first + refContacts[j], gains[j], weights[j]));
+		}
+		topology.fill(circuit, c, CIRCUIT_TAG_ROWS, CIRCUIT_TAGS, CIRCUIT_PROP_ROWS, CIRCUIT_PROPS);
+	}
+}
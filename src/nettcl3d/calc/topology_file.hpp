@@ -0,0 +1,56 @@
+/*
+ * calc/topology_file.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef CALC_TOPOLOGY_FILE_HPP_
+#define CALC_TOPOLOGY_FILE_HPP_
+
+#include <stdexcept>
+#include <string>
+#include "network.hpp"
+
+/*
+ * Network topology in a form suitable for memory mapping: contact
+ * parameter arrays, circuits as CSR matrix of contact references and
+ * tags and properties as indices into a table of interned strings.
+ * All arrays are aligned, so loading a network amounts to mapping the
+ * file and bulk copying of arrays. Read-only mapping shares pages among
+ * processes using the same file. Tags of contacts are read when first
+ * accessed, the file stays mapped until then.
+ * Contact state is not stored, loaded contacts are at rest.
+ */
+class TopologyFile {
+public:
+
+	static const unsigned version = 1;
+
+	struct FormatError : public std::runtime_error {
+
+		FormatError(const std::string& msg) : std::runtime_error("wrong topology file: " + msg) {}
+
+	};
+
+	/*
+	 * Contacts and interned strings are referred to by 32-bit indices,
+	 * network exceeding that is refused. File is written through a
+	 * temporary one and replaced by rename.
+	 */
+	static void save(const std::string& fileName, const Network& network);
+
+	/*
+	 * Appends contacts and circuits of the file to the network.
+	 */
+	static void load(const std::string& fileName, Network& network);
+
+};
+
+#endif /* CALC_TOPOLOGY_FILE_HPP_ */
@@ -0,0 +1,51 @@
+/*
+ * perturbator/dynamic.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef PERTURBATOR_DYNAMIC_HPP_
+#define PERTURBATOR_DYNAMIC_HPP_
+
+#include "../calc/field_drive.hpp"
+#include "helper.hpp"
+
+namespace perturbator {
+
+	/*
+	 * Time-dependent field (AC, ramp or pulses) applied to contacts
+	 * selected by tag expression. Network is not modified, the field is
+	 * added to the right-hand side by integrator.
+	 */
+	class Dynamic : public Helper {
+
+		Dynamic(const Dynamic& src) : drive(src.drive) {}
+
+		virtual phlib::Cloneable* doClone() const {
+			return new Dynamic(*this);
+		}
+
+		virtual const FieldDrive* doGetFieldDrive() const {
+			return &drive;
+		}
+
+	public:
+
+		Dynamic(const FieldDrive::Params& params) : drive(params) {}
+
+	private:
+
+		const FieldDrive drive;
+
+	};
+
+}
+
+#endif /* PERTURBATOR_DYNAMIC_HPP_ */
@@ -49,7 +49,7 @@ namespace perturbator {
 					i != last;
 					++i, ++z) {
 
-				network.contact(*i).h = *z - sum;
+				network.setH(*i, *z - sum);
 			}
 		}
 
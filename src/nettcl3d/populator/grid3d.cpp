@@ -80,8 +80,7 @@ void Grid3d::doPopulate(Network& network) {
 }
 
 Grid3d::index_type Grid3d::addXContact(Network& network, unsigned x, unsigned y, unsigned z) {
-	const index_type index = addContact(network);
-	Contact& c = network.contact(index);
+	Contact c = makeContact();
 
 	c.addTag(tags::x);
 	c.setProp(props::x, x - 1);
@@ -103,12 +102,11 @@ Grid3d::index_type Grid3d::addXContact(Network& network, unsigned x, unsigned y,
 		c.hNormal.z -= 1.0;
 	}
 
-	return index;
+	return network.addContact(c);
 }
 
 Grid3d::index_type Grid3d::addYContact(Network& network, unsigned x, unsigned y, unsigned z) {
-	const index_type index = addContact(network);
-	Contact& c = network.contact(index);
+	Contact c = makeContact();
 
 	c.addTag(tags::y);
 	c.setProp(props::x, x);
@@ -130,12 +128,11 @@ Grid3d::index_type Grid3d::addYContact(Network& network, unsigned x, unsigned y,
 		c.hNormal.x -= 1.0;
 	}
 
-	return index;
+	return network.addContact(c);
 }
 
 Grid3d::index_type Grid3d::addZContact(Network& network, unsigned x, unsigned y, unsigned z) {
-	const index_type index = addContact(network);
-	Contact& c = network.contact(index);
+	Contact c = makeContact();
 
 	c.addTag(tags::z);
 	c.setProp(props::x, x);
@@ -157,11 +154,11 @@ Grid3d::index_type Grid3d::addZContact(Network& network, unsigned x, unsigned y,
 		c.hNormal.y -= 1.0;
 	}
 
-	return index;
+	return network.addContact(c);
 }
 
-Grid3d::index_type Grid3d::addContact(Network& network) {
-	return network.addContact(Contact(params.betaRng(), params.tauRng(), params.vRng()));
+Contact Grid3d::makeContact() {
+	return Contact(params.betaRng(), params.tauRng(), params.vRng());
 }
 
 void Grid3d::setContactTags(Contact& c, unsigned x, unsigned y, unsigned z, bool isX, bool isY, bool isZ) {
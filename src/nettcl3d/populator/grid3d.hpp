@@ -65,7 +65,7 @@ namespace populator {
 		index_type addXContact(Network& network, unsigned x, unsigned y, unsigned z);
 		index_type addYContact(Network& network, unsigned x, unsigned y, unsigned z);
 		index_type addZContact(Network& network, unsigned x, unsigned y, unsigned z);
-		index_type addContact(Network& network);
+		Contact makeContact();
 		void setContactTags(Contact& c, unsigned x, unsigned y, unsigned z, bool isX, bool isY, bool isZ);
 
 		static void addContactRef(Circuit& c, index_type index, const double gain, const double weight);
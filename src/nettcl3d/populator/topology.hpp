@@ -0,0 +1,47 @@
+/*
+ * populator/topology.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef POPULATOR_TOPOLOGY_HPP_
+#define POPULATOR_TOPOLOGY_HPP_
+
+#include <string>
+#include "../calc/abstract_populator.hpp"
+#include "../calc/topology_file.hpp"
+
+namespace populator {
+
+	/*
+	 * Populates network from topology file (see TopologyFile).
+	 */
+	class Topology : public AbstractPopulator {
+	public:
+
+		Topology(const std::string& fileName) : fileName(fileName) {
+		}
+
+	private:
+
+		const std::string fileName;
+
+		virtual void doPopulate(Network& network) {
+			TopologyFile::load(fileName, network);
+		}
+
+		virtual phlib::Cloneable* doClone() const {
+			return new Topology(fileName);
+		}
+
+	};
+}
+
+#endif /* POPULATOR_TOPOLOGY_HPP_ */
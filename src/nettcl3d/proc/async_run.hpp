@@ -0,0 +1,304 @@
+/*
+ * proc/async_run.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef PROC_ASYNC_RUN_HPP_
+#define PROC_ASYNC_RUN_HPP_
+
+#include <tcl.h>
+#include <exception>
+#include <string>
+#include <vector>
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "../calc/integrator.hpp"
+#include "../calc/network.hpp"
+#include "../calc/run_stats.hpp"
+#include "busy.hpp"
+
+namespace proc {
+
+	/*
+	 * Run of integrator on a background thread. Progress and completion
+	 * are posted as events to the thread that started the run and reported
+	 * by evaluating callback script there with appended arguments:
+	 *   progress time stepsPerSecond eta
+	 *   done time | cancelled time | error message
+	 * where steps are accepted solver steps and eta is estimated wall time
+	 * to the end of the run in seconds. Tcl objects are not touched by the
+	 * background thread, networks and integrator are held by shared
+	 * pointers, tracers and perturbators are held by integrator wrapper,
+	 * which cancels and joins the run when freed. The background thread
+	 * holds a reference to the run until its final event is handled, so
+	 * the run is always destroyed by the owner thread. The network, tracers
+	 * and perturbators stay busy until then, see Busy.
+	 */
+	class AsyncRun : public Integrator::Monitor, boost::noncopyable {
+	public:
+
+		AsyncRun(
+				Tcl_Interp* const interp,
+				Tcl_Obj* const callback,
+				const boost::shared_ptr<Integrator>& engine,
+				const boost::shared_ptr<Network>& network,
+				double const startTime,
+				double const endTime,
+				double const dt,
+				double const interval) :
+			interp(interp),
+			callback(callback),
+			owner(Tcl_GetCurrentThread()),
+			engine(engine),
+			network(network),
+			startTime(startTime),
+			endTime(endTime),
+			dt(dt),
+			interval(interval),
+			running(false),
+			lastTime(startTime),
+			lastReport(0.0) {
+
+			Tcl_Preserve(interp);
+			if (callback) {
+				Tcl_IncrRefCount(callback);
+			}
+		}
+
+		// joined by the final event, see handle()
+		virtual ~AsyncRun() {
+			if (callback) {
+				Tcl_DecrRefCount(callback);
+			}
+			Tcl_Release(interp);
+		}
+
+		static void start(const boost::shared_ptr<AsyncRun>& run) {
+			run->snapshot.lastStep = run->engine->getLastStep();
+			run->snapshot.convergenceTime = -1.0;
+
+			run->busy.push_back(run->network.get());
+			run->busy.insert(run->busy.end(), run->engine->getTracers().begin(), run->engine->getTracers().end());
+			run->busy.insert(run->busy.end(), run->engine->getPerturbators().begin(), run->engine->getPerturbators().end());
+			for (std::vector<const void*>::const_iterator i = run->busy.begin(), last = run->busy.end(); i != last; ++i) {
+				Busy::acquire(*i);
+			}
+
+			// cancel() issued from now on stops this run
+			run->engine->clearCancel();
+
+			boost::shared_ptr<AsyncRun>* const ref = new boost::shared_ptr<AsyncRun>(run);
+			run->running = true;
+			run->engine->setMonitor(run.get());
+			try {
+				run->thread = boost::thread(&AsyncRun::work, ref);
+			} catch (...) {
+				run->engine->setMonitor(0);
+				run->running = false;
+				run->release();
+				delete ref;
+				throw;
+			}
+		}
+
+		bool isRunning() const {
+			return running;
+		}
+
+		void cancel() {
+			engine->cancel();
+		}
+
+		// results of the integrator published by background thread at every time point
+		struct Snapshot {
+			RunStats stats;
+			double lastStep, convergenceTime;
+		};
+
+		Snapshot getSnapshot() const {
+			const boost::mutex::scoped_lock lock(mutex);
+			return snapshot;
+		}
+
+		/*
+		 * Waits for the background thread, must be called by the owner thread.
+		 */
+		void join() {
+			if (thread.joinable()) {
+				thread.join();
+			}
+		}
+
+	private:
+
+		typedef enum {PROGRESS, DONE, CANCELLED, FAILED} Kind;
+
+		// allocated by Tcl, so holds plain data only
+		struct Event {
+			Tcl_Event header;
+			AsyncRun* run;
+			boost::shared_ptr<AsyncRun>* ref;	// reference of background thread, final event only
+			Kind kind;
+			double time, rate, eta;
+		};
+
+		Tcl_Interp* const interp;
+		Tcl_Obj* const callback;
+		const Tcl_ThreadId owner;
+		const boost::shared_ptr<Integrator> engine;
+		const boost::shared_ptr<Network> network;
+		const double startTime, endTime, dt, interval;
+
+		boost::thread thread;
+		boost::atomic<bool> running;
+		std::string error;	// written by background thread before DONE or FAILED is posted
+		std::vector<const void*> busy;	// used by owner thread only
+
+		mutable boost::mutex mutex;
+		Snapshot snapshot;
+
+		// used by background thread only
+		RunStats::Stopwatch watch;
+		double lastTime, lastReport;
+
+		/*
+		 * Reference to the run is handed over to the final event and never
+		 * released by this thread. Events are handled in order, so progress
+		 * events need no reference of their own.
+		 */
+		static void work(boost::shared_ptr<AsyncRun>* const ref) {
+			AsyncRun* const run = ref->get();
+			run->watch = RunStats::Stopwatch();
+
+			Kind kind = DONE;
+			try {
+				run->engine->run(*run->network, run->startTime, run->endTime, run->dt);
+				if (run->engine->wasCancelled()) {
+					kind = CANCELLED;
+				}
+			} catch (const std::exception& ex) {
+				run->error = ex.what();
+				kind = FAILED;
+			} catch (...) {
+				run->error = "unexpected error";
+				kind = FAILED;
+			}
+
+			run->publish(run->engine->getStats(), run->engine->getStats().wallTime);
+			run->engine->setMonitor(0);
+			run->running = false;
+			run->post(kind, run->lastTime, 0.0, 0.0, ref);
+		}
+
+		virtual void onTimePoint(double const time, const RunStats& stats) {
+			lastTime = time;
+			publish(stats, watch.elapsed());
+
+			const double elapsed = watch.elapsed();
+			if (elapsed - lastReport < interval || !callback) {
+				return;
+			}
+			lastReport = elapsed;
+
+			const double done = time - startTime;
+			const double eta = done > 0.0 ? elapsed * (endTime - time) / done : 0.0;
+			post(PROGRESS, time, elapsed > 0.0 ? stats.acceptedSteps / elapsed : 0.0, eta, 0);
+		}
+
+		void publish(const RunStats& stats, double const wallTime) {
+			const boost::mutex::scoped_lock lock(mutex);
+			snapshot.stats = stats;
+			snapshot.stats.wallTime = wallTime;
+			snapshot.lastStep = engine->getLastStep();
+			snapshot.convergenceTime = engine->getConvergenceTime();
+		}
+
+		void post(Kind const kind, double const time, double const rate, double const eta, boost::shared_ptr<AsyncRun>* const ref) {
+			Event* const e = reinterpret_cast<Event*>(ckalloc(sizeof(Event)));
+			e->header.proc = &AsyncRun::handle;
+			e->header.nextPtr = NULL;
+			e->run = this;
+			e->ref = ref;
+			e->kind = kind;
+			e->time = time;
+			e->rate = rate;
+			e->eta = eta;
+
+			Tcl_ThreadQueueEvent(owner, &e->header, TCL_QUEUE_TAIL);
+			Tcl_ThreadAlert(owner);
+		}
+
+		static int handle(Tcl_Event* const header, int /* flags */) {
+			Event* const e = reinterpret_cast<Event*>(header);
+
+			// released on return, possibly destroying the run
+			boost::shared_ptr<AsyncRun> ref;
+			if (e->ref) {
+				ref = *e->ref;
+				delete e->ref;
+				e->run->join();
+				e->run->release();
+			}
+
+			e->run->report(*e);
+			return 1;
+		}
+
+		void release() {
+			for (std::vector<const void*>::const_iterator i = busy.begin(), last = busy.end(); i != last; ++i) {
+				Busy::release(*i);
+			}
+			busy.clear();
+		}
+
+		void report(const Event& e) {
+			if (!callback || Tcl_InterpDeleted(interp)) {
+				return;
+			}
+
+			Tcl_Obj* const cmd = Tcl_DuplicateObj(callback);
+			Tcl_IncrRefCount(cmd);
+			switch (e.kind) {
+			case PROGRESS:
+				Tcl_ListObjAppendElement(interp, cmd, Tcl_NewStringObj("progress", -1));
+				Tcl_ListObjAppendElement(interp, cmd, Tcl_NewDoubleObj(e.time));
+				Tcl_ListObjAppendElement(interp, cmd, Tcl_NewDoubleObj(e.rate));
+				Tcl_ListObjAppendElement(interp, cmd, Tcl_NewDoubleObj(e.eta));
+				break;
+
+			case DONE:
+			case CANCELLED:
+				Tcl_ListObjAppendElement(interp, cmd, Tcl_NewStringObj(DONE == e.kind ? "done" : "cancelled", -1));
+				Tcl_ListObjAppendElement(interp, cmd, Tcl_NewDoubleObj(e.time));
+				break;
+
+			case FAILED:
+				Tcl_ListObjAppendElement(interp, cmd, Tcl_NewStringObj("error", -1));
+				Tcl_ListObjAppendElement(interp, cmd, Tcl_NewStringObj(error.c_str(), -1));
+				break;
+			}
+
+			Tcl_Preserve(interp);
+			if (TCL_OK != Tcl_EvalObjEx(interp, cmd, TCL_EVAL_GLOBAL)) {
+				Tcl_BackgroundError(interp);
+			}
+			Tcl_Release(interp);
+			Tcl_DecrRefCount(cmd);
+		}
+
+	};
+
+}
+
+#endif /* PROC_ASYNC_RUN_HPP_ */
@@ -0,0 +1,70 @@
+/*
+ * proc/busy.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef PROC_BUSY_HPP_
+#define PROC_BUSY_HPP_
+
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <boost/thread/mutex.hpp>
+
+namespace proc {
+
+	/*
+	 * Networks, tracers and perturbators in use by asynchronous runs.
+	 * Commands refuse to read or change a busy object, since the background
+	 * thread does so without locking. Objects are marked and released by
+	 * the thread that started the run.
+	 */
+	class Busy {
+	public:
+
+		static void acquire(const void* const object) {
+			const boost::mutex::scoped_lock lock(mutex());
+			objects().insert(object);
+		}
+
+		static void release(const void* const object) {
+			const boost::mutex::scoped_lock lock(mutex());
+			objects().erase(object);
+		}
+
+		static bool isBusy(const void* const object) {
+			const boost::mutex::scoped_lock lock(mutex());
+			return objects().count(object) > 0;
+		}
+
+		static void check(const void* const object, const std::string& what) {
+			if (isBusy(object)) {
+				throw std::runtime_error(what + " is used by asynchronous run");
+			}
+		}
+
+	private:
+
+		static std::set<const void*>& objects() {
+			static std::set<const void*> objects;
+			return objects;
+		}
+
+		static boost::mutex& mutex() {
+			static boost::mutex mutex;
+			return mutex;
+		}
+
+	};
+
+}
+
+#endif /* PROC_BUSY_HPP_ */
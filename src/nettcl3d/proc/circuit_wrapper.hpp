@@ -15,6 +15,7 @@
 #define PROC_CIRCUIT_WRAPPER_HPP_
 
 #include "../calc/circuit.hpp"
+#include "busy.hpp"
 #include "tagable_wrapper.hpp"
 
 namespace proc {
@@ -58,6 +59,10 @@ namespace proc {
 
 			const std::string cmd = Tcl_GetStringFromObj(objv[1], NULL);
 
+			if ("exists" != cmd && objc > 2 && isInstanceOf(objv[2])) {
+				Busy::check(validateArg(interp, objv[2])->network.get(), "network");
+			}
+
 			try {
 
 				if ("exists" == cmd) {
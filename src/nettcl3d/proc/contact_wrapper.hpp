@@ -16,6 +16,7 @@
 
 #include "../calc/contact.hpp"
 #include "../calc/network.hpp"
+#include "busy.hpp"
 #include "tagable_wrapper.hpp"
 
 namespace proc {
@@ -46,7 +47,7 @@ namespace proc {
 		}
 
 		virtual Tagable& tagable() {
-			return contact();
+			return network->contactTagable(index);
 		}
 
 		static int doMain(ClientData clientData, Tcl_Interp * interp, int objc, Tcl_Obj * const objv[]) {
@@ -59,6 +60,10 @@ namespace proc {
 
 			const std::string cmd = Tcl_GetStringFromObj(objv[1], NULL);
 
+			if ("exists" != cmd && objc > 2 && isInstanceOf(objv[2])) {
+				Busy::check(validateArg(interp, objv[2])->network.get(), "network");
+			}
+
 			try {
 
 				if ("exists" == cmd) {
@@ -85,20 +90,20 @@ namespace proc {
 				throw WrongNumArgs(interp, 0, objv, "parameter");
 
 			const std::string param = Tcl_GetStringFromObj(objv[0], NULL);
-			const Contact& c = contact();
+			const Network& n = *network;
 
 			if ("beta" == param) {
-				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.beta));
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(n.getBeta(index)));
 			} else if ("tau" == param) {
-				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.tau));
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(n.getTau(index)));
 			} else if ("v" == param) {
-				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.v));
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(n.getV(index)));
 			} else if ("h" == param) {
-				Tcl_SetObjResult(interp, phlib::TclUtils::toListOfDouble(interp, c.h.toVector()));
+				Tcl_SetObjResult(interp, phlib::TclUtils::toListOfDouble(interp, n.getH(index).toVector()));
 			} else if ("phase" == param) {
-				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.phase));
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(n.getPhase(index)));
 			} else if ("voltage" == param) {
-				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(c.voltage));
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(n.getVoltage(index)));
 			} else if ("tags" == param) {
 				Tcl_SetObjResult(interp, getTagsObj(interp));
 			} else {
@@ -115,17 +120,17 @@ namespace proc {
 			const std::string param = Tcl_GetStringFromObj(objv[0], NULL);
 
 			if ("beta" == param) {
-				contact().beta = phlib::TclUtils::getDouble(interp, objv[1]);
+				network->setBeta(index, phlib::TclUtils::getDouble(interp, objv[1]));
 			} else if ("tau" == param) {
-				contact().tau = phlib::TclUtils::getDouble(interp, objv[1]);
+				network->setTau(index, phlib::TclUtils::getDouble(interp, objv[1]));
 			} else if ("v" == param) {
-				contact().v = phlib::TclUtils::getDouble(interp, objv[1]);
+				network->setV(index, phlib::TclUtils::getDouble(interp, objv[1]));
 			} else if ("h" == param) {
-				contact().h = Point::fromVector(phlib::TclUtils::getDoubleVector(interp, objv[1]));
+				network->setH(index, Point::fromVector(phlib::TclUtils::getDoubleVector(interp, objv[1])));
 			} else if ("phase" == param) {
-				contact().phase = phlib::TclUtils::getDouble(interp, objv[1]);
+				network->setPhase(index, phlib::TclUtils::getDouble(interp, objv[1]));
 			} else if ("voltage" == param) {
-				contact().voltage = phlib::TclUtils::getDouble(interp, objv[1]);
+				network->setVoltage(index, phlib::TclUtils::getDouble(interp, objv[1]));
 			} else {
 				throw WrongArgValue(interp, "beta | tau | v | h | phase | voltage");
 			}
@@ -133,10 +138,6 @@ namespace proc {
 			return TCL_OK;
 		}
 
-		Contact& contact() {
-			return network->contact(index);
-		}
-
 	public:
 
 		static void registerCommands(Tcl_Interp * interp) {
@@ -14,9 +14,15 @@
 #ifndef PROC_INTEGRATOR_WRAPPER_HPP_
 #define PROC_INTEGRATOR_WRAPPER_HPP_
 
+#include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include "wrapper.hpp"
 #include "../calc/integrator.hpp"
+#include "../calc/sweep.hpp"
+#include "../calc/batch.hpp"
+#include "../calc/event_detector.hpp"
+#include "async_run.hpp"
+#include "busy.hpp"
 #include "network_wrapper.hpp"
 #include "tracer_wrapper.hpp"
 #include "perturbator_wrapper.hpp"
@@ -31,16 +37,84 @@ namespace proc {
 
 		typedef Wrapper<&type::integrator> Base;
 
+		// evaluates script with event appended as {type time network index direction}
+		class EventCallback : public EventDetector::Listener, boost::noncopyable {
+		public:
+
+			EventCallback(Tcl_Interp* const interp, Tcl_Obj* const script) : interp(interp), script(script) {
+				Tcl_IncrRefCount(script);
+			}
+
+			EventCallback* clone() const {
+				return new EventCallback(interp, script);
+			}
+
+			virtual ~EventCallback() {
+				Tcl_DecrRefCount(script);
+			}
+
+			virtual void onEvent(const EventDetector::Event& e) {
+				Tcl_Obj* const cmd = Tcl_DuplicateObj(script);
+				Tcl_IncrRefCount(cmd);
+				Tcl_ListObjAppendElement(interp, cmd, event(interp, e));
+
+				const int status = Tcl_EvalObjEx(interp, cmd, TCL_EVAL_GLOBAL);
+				Tcl_DecrRefCount(cmd);
+				if (TCL_OK != status) {
+					throw std::runtime_error(Tcl_GetStringResult(interp));
+				}
+			}
+
+		private:
+
+			Tcl_Interp* const interp;
+			Tcl_Obj* const script;
+
+		};
+
 		boost::shared_ptr<Integrator> engine;
 		VarRefVector perturbatorRefs;
-
+		boost::shared_ptr<EventCallback> eventCallback;
+		boost::shared_ptr<EventDetector> eventDetector;
+		boost::shared_ptr<AsyncRun> asyncRun;
+
+		/*
+		 * Copy detects the same kinds of events with its own detector and
+		 * callback, it does not share collected events with the source. Log
+		 * file is left to the source, opening it again would truncate it.
+		 */
 		explicit IntegratorWrapper(const IntegratorWrapper& src) :
 			engine(dynamic_cast<Integrator*>(src.engine->clone())),
-			perturbatorRefs(src.perturbatorRefs) {}
+			perturbatorRefs(src.perturbatorRefs) {
+
+			engine->setEventDetector(0);
+			if (src.eventDetector) {
+				EventDetector::Params params = src.eventDetector->getParams();
+				params.fileName.clear();
+				params.listener = 0;
+				if (src.eventCallback) {
+					eventCallback.reset(src.eventCallback->clone());
+					params.listener = eventCallback.get();
+				}
+
+				eventDetector.reset(new EventDetector(params));
+				engine->setEventDetector(eventDetector.get());
+			}
+		}
 
 		explicit IntegratorWrapper(Integrator* const engine) :
 			engine(engine) {}
 
+		// background thread uses tracers, perturbators and event detector held here
+		virtual ~IntegratorWrapper() {
+			if (isRunning()) {
+				asyncRun->cancel();
+			}
+			if (asyncRun) {
+				asyncRun->join();
+			}
+		}
+
 		static IntegratorWrapper* validateArg(Tcl_Interp *interp, const Tcl_Obj* arg) {
 			return static_cast<IntegratorWrapper*>(Base::validateArg(interp, arg));
 		}
@@ -59,6 +133,11 @@ namespace proc {
 
 			const std::string cmd = Tcl_GetStringFromObj(objv[1], NULL);
 
+			// running instance may only be queried or cancelled
+			if ("get" != cmd && "cancel" != cmd && objc > 2 && isInstanceOf(objv[2]) && validateArg(interp, objv[2])->isRunning()) {
+				throw std::runtime_error("integrator is running");
+			}
+
 			try {
 				if ("create" == cmd) {
 					return create(interp, objc - 2, objv + 2);
@@ -80,6 +159,42 @@ namespace proc {
 					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::run));
 				}
 
+				else if ("run-async" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::runAsync));
+				}
+
+				else if ("cancel" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::cancel));
+				}
+
+				else if ("run-ensemble" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::runEnsemble));
+				}
+
+				else if ("sweep" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::sweep));
+				}
+
+				else if ("run-many" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::runMany));
+				}
+
+				else if ("save" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::save));
+				}
+
+				else if ("load" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::load));
+				}
+
+				else if ("detect-events" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::detectEvents));
+				}
+
+				else if ("events" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::events));
+				}
+
 				else if ("add-tracer" == cmd) {
 					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&IntegratorWrapper::addTracer));
 				}
@@ -97,7 +212,7 @@ namespace proc {
 				}
 
 				else
-					throw WrongArgValue(interp, "create | exists | get | set | run | add-tracer | purge-tracers | add-perturbator | purge-perturbators");
+					throw WrongArgValue(interp, "create | exists | get | set | run | run-async | cancel | run-ensemble | sweep | run-many | save | load | detect-events | events | add-tracer | purge-tracers | add-perturbator | purge-perturbators");
 			} catch (WrongNumArgs& ex) {
 				throw WrongNumArgs(interp, 2 + ex.objc, objv, ex.message);
 			}
@@ -106,8 +221,8 @@ namespace proc {
 		}
 
 		static int create(Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
-			if (objc > 3)
-				throw WrongNumArgs(interp, 0, objv, "?step? ?absErr? ?relErr?");
+			if (objc > 4)
+				throw WrongNumArgs(interp, 0, objv, "?step? ?absErr? ?relErr? ?stepper?");
 
 			Integrator::Params params;
 			if (objc > 0) {
@@ -119,6 +234,9 @@ namespace proc {
 			if (objc > 2) {
 				params.relErr = phlib::TclUtils::getDouble(interp, objv[2]);
 			}
+			if (objc > 3) {
+				params.stepper = getStepper(interp, objv[3]);
+			}
 
 			// instantiate new TCL object
 			Tcl_Obj* const w = Tcl_NewObj();
@@ -129,6 +247,14 @@ namespace proc {
 			return TCL_OK;
 		}
 
+		static std::string getStepper(Tcl_Interp * interp, Tcl_Obj * CONST obj) {
+			const std::string stepper = Tcl_GetStringFromObj(obj, NULL);
+			if (!Stepper::isSupported(stepper)) {
+				throw WrongArgValue(interp, Stepper::names());
+			}
+			return stepper;
+		}
+
 		int get(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
 			if (objc < 1)
 				throw WrongNumArgs(interp, 0, objv, "parameter");
@@ -141,8 +267,32 @@ namespace proc {
 				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(engine->getParams().absErr));
 			} else if ("relErr" == param) {
 				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(engine->getParams().relErr));
+			} else if ("simd" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(ContactKernel(engine->getParams().simd).getName().c_str(), -1));
+			} else if ("threads" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewLongObj(engine->getParams().threads));
+			} else if ("stepper" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(engine->getParams().stepper.c_str(), -1));
+			} else if ("checkpointFile" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(engine->getParams().checkpointFile.c_str(), -1));
+			} else if ("checkpointInterval" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(engine->getParams().checkpointInterval));
+			} else if ("denseOutput" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewBooleanObj(engine->getParams().denseOutput ? 1 : 0));
+			} else if ("steadyWindow" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(engine->getParams().steadyWindow));
+			} else if ("steadyTolerance" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(engine->getParams().steadyTolerance));
+			} else if ("lastStep" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(isRunning() ? asyncRun->getSnapshot().lastStep : engine->getLastStep()));
+			} else if ("convergenceTime" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewDoubleObj(isRunning() ? asyncRun->getSnapshot().convergenceTime : engine->getConvergenceTime()));
+			} else if ("statsFile" == param) {
+				Tcl_SetObjResult(interp, Tcl_NewStringObj(engine->getParams().statsFile.c_str(), -1));
+			} else if ("stats" == param) {
+				Tcl_SetObjResult(interp, stats(interp, isRunning() ? asyncRun->getSnapshot().stats : engine->getStats()));
 			} else {
-				throw WrongArgValue(interp, "step | absErr | relErr");
+				throw WrongArgValue(interp, "step | absErr | relErr | simd | threads | stepper | checkpointFile | checkpointInterval | denseOutput | steadyWindow | steadyTolerance | statsFile | lastStep | convergenceTime | stats");
 			}
 
 			return TCL_OK;
@@ -160,8 +310,34 @@ namespace proc {
 				engine->getParams().absErr = phlib::TclUtils::getDouble(interp, objv[1]);
 			} else if ("relErr" == param) {
 				engine->getParams().relErr = phlib::TclUtils::getDouble(interp, objv[1]);
+			} else if ("simd" == param) {
+				const std::string simd = Tcl_GetStringFromObj(objv[1], NULL);
+				if (!ContactKernel::isSupported(simd)) {
+					throw WrongArgValue(interp, "auto | scalar | sse2 | avx2 | avx512 (supported by CPU)");
+				}
+				engine->getParams().simd = simd;
+			} else if ("threads" == param) {
+				engine->getParams().threads = phlib::TclUtils::getUInt(interp, objv[1]);
+			} else if ("stepper" == param) {
+				engine->getParams().stepper = getStepper(interp, objv[1]);
+			} else if ("checkpointFile" == param) {
+				engine->getParams().checkpointFile = Tcl_GetStringFromObj(objv[1], NULL);
+			} else if ("checkpointInterval" == param) {
+				engine->getParams().checkpointInterval = phlib::TclUtils::getDouble(interp, objv[1]);
+			} else if ("denseOutput" == param) {
+				int denseOutput;
+				if (TCL_OK != Tcl_GetBooleanFromObj(interp, objv[1], &denseOutput)) {
+					throw WrongArgValue(interp, "boolean value expected");
+				}
+				engine->getParams().denseOutput = denseOutput != 0;
+			} else if ("steadyWindow" == param) {
+				engine->getParams().steadyWindow = phlib::TclUtils::getDouble(interp, objv[1]);
+			} else if ("steadyTolerance" == param) {
+				engine->getParams().steadyTolerance = phlib::TclUtils::getDouble(interp, objv[1]);
+			} else if ("statsFile" == param) {
+				engine->getParams().statsFile = Tcl_GetStringFromObj(objv[1], NULL);
 			} else {
-				throw WrongArgValue(interp, "step | absErr | relErr");
+				throw WrongArgValue(interp, "step | absErr | relErr | simd | threads | stepper | checkpointFile | checkpointInterval | denseOutput | steadyWindow | steadyTolerance | statsFile");
 			}
 
 			return TCL_OK;
@@ -171,8 +347,91 @@ namespace proc {
 			if (objc != 4)
 				throw WrongNumArgs(interp, 0, objv, "networkInst startTime endTime dt");
 
+			Network& network = *NetworkWrapper::validateArg(interp, objv[0])->engine;
+			checkIdle(network);
+
+			engine->clearCancel();
+			engine->run(
+				network,
+				phlib::TclUtils::getDouble(interp, objv[1]),
+				phlib::TclUtils::getDouble(interp, objv[2]),
+				phlib::TclUtils::getDouble(interp, objv[3]));
+
+			return TCL_OK;
+		}
+
+		bool isRunning() const {
+			return asyncRun && asyncRun->isRunning();
+		}
+
+		// network, tracers and perturbators must not be used by an asynchronous run of another integrator
+		void checkIdle(const Network& network) const {
+			Busy::check(&network, "network");
+			for (Integrator::TracerVector::const_iterator i = engine->getTracers().begin(), last = engine->getTracers().end(); i != last; ++i) {
+				Busy::check(*i, "tracer");
+			}
+			for (Integrator::PerturbatorVector::const_iterator i = engine->getPerturbators().begin(), last = engine->getPerturbators().end(); i != last; ++i) {
+				Busy::check(*i, "perturbator");
+			}
+		}
+
+		int runAsync(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 4 || objc > 6)
+				throw WrongNumArgs(interp, 0, objv, "networkInst startTime endTime dt ?callback? ?interval?");
+
+			if (eventCallback) {
+				throw WrongArgValue(interp, "event callback cannot be used in asynchronous run");
+			}
+
+			const boost::shared_ptr<Network> network = NetworkWrapper::validateArg(interp, objv[0])->engine;
+			checkIdle(*network);
+
+			const double interval = objc > 5 ? phlib::TclUtils::getDouble(interp, objv[5]) : 1.0;
+			boost::shared_ptr<AsyncRun> run(new AsyncRun(
+				interp,
+				objc > 4 ? objv[4] : NULL,
+				engine,
+				network,
+				phlib::TclUtils::getDouble(interp, objv[1]),
+				phlib::TclUtils::getDouble(interp, objv[2]),
+				phlib::TclUtils::getDouble(interp, objv[3]),
+				interval));
+
+			asyncRun = run;
+			AsyncRun::start(run);
+
+			return TCL_OK;
+		}
+
+		int cancel(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 0)
+				throw WrongNumArgs(interp, 0, objv, "");
+
+			if (isRunning()) {
+				asyncRun->cancel();
+			}
+
+			return TCL_OK;
+		}
+
+		int runEnsemble(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 4)
+				throw WrongNumArgs(interp, 0, objv, "networkInstVector startTime endTime dt");
+
+			const std::vector<Tcl_Obj*> objs = phlib::TclUtils::getObjectVector(interp, objv[0]);
+			if (objs.empty() || objs.size() > RhsKernel::maxLanes) {
+				throw WrongArgValue(interp, "1 to 256 networks required");
+			}
+
+			Integrator::NetworkVector networks;
+			for (std::vector<Tcl_Obj*>::const_iterator i = objs.begin(), last = objs.end(); i != last; ++i) {
+				networks.push_back(NetworkWrapper::validateArg(interp, *i)->engine.get());
+				checkIdle(*networks.back());
+			}
+
+			engine->clearCancel();
 			engine->run(
-				*NetworkWrapper::validateArg(interp, objv[0])->engine,
+				networks,
 				phlib::TclUtils::getDouble(interp, objv[1]),
 				phlib::TclUtils::getDouble(interp, objv[2]),
 				phlib::TclUtils::getDouble(interp, objv[3]));
@@ -180,6 +439,232 @@ namespace proc {
 			return TCL_OK;
 		}
 
+		int sweep(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 8 || objc > 9)
+				throw WrongNumArgs(interp, 0, objv, "networkInst parameter from to step settleTime measureTime dt ?hysteresis?");
+
+			Network& network = *NetworkWrapper::validateArg(interp, objv[0])->engine;
+			checkIdle(network);
+
+			const Sweep::Params params = getSweepParams(interp, objc - 1, objv + 1);
+			engine->clearCancel();
+			const Sweep::ResultVector results = Sweep(*engine, params).run(network);
+			Tcl_SetObjResult(interp, sweepResults(interp, results));
+
+			return TCL_OK;
+		}
+
+		static Sweep::Params getSweepParams(Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			Sweep::Params params;
+
+			const std::string s = Tcl_GetStringFromObj(objv[0], NULL);
+			if ("hx" == s) {
+				params.parameter = Sweep::HX;
+			} else if ("hy" == s) {
+				params.parameter = Sweep::HY;
+			} else if ("hz" == s) {
+				params.parameter = Sweep::HZ;
+			} else {
+				throw WrongArgValue(interp, "hx | hy | hz");
+			}
+
+			params.from = phlib::TclUtils::getDouble(interp, objv[1]);
+			params.to = phlib::TclUtils::getDouble(interp, objv[2]);
+			params.step = phlib::TclUtils::getDouble(interp, objv[3]);
+			params.settleTime = phlib::TclUtils::getDouble(interp, objv[4]);
+			params.measureTime = phlib::TclUtils::getDouble(interp, objv[5]);
+			params.dt = phlib::TclUtils::getDouble(interp, objv[6]);
+			if (objc > 7) {
+				int hysteresis;
+				if (TCL_OK != Tcl_GetBooleanFromObj(interp, objv[7], &hysteresis)) {
+					throw WrongArgValue(interp, "boolean value expected");
+				}
+				params.hysteresis = hysteresis != 0;
+			}
+
+			return params;
+		}
+
+		// list of {value voltage flux}
+		static Tcl_Obj* sweepResults(Tcl_Interp * interp, const Sweep::ResultVector& results) {
+			Tcl_Obj* const list = Tcl_NewListObj(0, NULL);
+			for (Sweep::ResultVector::const_iterator i = results.begin(), last = results.end(); i != last; ++i) {
+				Tcl_Obj* const point[] = {Tcl_NewDoubleObj(i->value), Tcl_NewDoubleObj(i->voltage), Tcl_NewDoubleObj(i->flux)};
+				Tcl_ListObjAppendElement(interp, list, Tcl_NewListObj(3, point));
+			}
+			return list;
+		}
+
+		/*
+		 * Every job is either {networkInst startTime endTime dt} or
+		 * {networkInst parameter from to step settleTime measureTime dt ?hysteresis?}.
+		 * Result is a list with mean voltage of every run job and list of
+		 * points of every sweep job.
+		 */
+		int runMany(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 1)
+				throw WrongNumArgs(interp, 0, objv, "jobVector");
+
+			Batch batch(engine->getParams());
+
+			const std::vector<Tcl_Obj*> jobs = phlib::TclUtils::getObjectVector(interp, objv[0]);
+			for (std::vector<Tcl_Obj*>::const_iterator i = jobs.begin(), last = jobs.end(); i != last; ++i) {
+				const std::vector<Tcl_Obj*> args = phlib::TclUtils::getObjectVector(interp, *i);
+
+				Batch::Job job;
+				if (4 == args.size()) {
+					job.startTime = phlib::TclUtils::getDouble(interp, args[1]);
+					job.endTime = phlib::TclUtils::getDouble(interp, args[2]);
+					job.dt = phlib::TclUtils::getDouble(interp, args[3]);
+				} else if (8 == args.size() || 9 == args.size()) {
+					job.sweep = true;
+					job.sweepParams = getSweepParams(interp, args.size() - 1, &args[1]);
+				} else {
+					throw WrongArgValue(interp, "{networkInst startTime endTime dt} or {networkInst parameter from to step settleTime measureTime dt ?hysteresis?} expected");
+				}
+				job.network = NetworkWrapper::validateArg(interp, args[0])->engine.get();
+				Busy::check(job.network, "network");
+
+				batch.add(job);
+			}
+
+			batch.run();
+
+			Tcl_Obj* const list = Tcl_NewListObj(0, NULL);
+			for (Batch::JobVector::const_iterator i = batch.getJobs().begin(), last = batch.getJobs().end(); i != last; ++i) {
+				Tcl_ListObjAppendElement(interp, list, i->sweep ? sweepResults(interp, i->sweepResults) : Tcl_NewDoubleObj(i->voltage));
+			}
+			Tcl_SetObjResult(interp, list);
+
+			return TCL_OK;
+		}
+
+		int save(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 2 || objc > 3)
+				throw WrongNumArgs(interp, 0, objv, "networkInst fileName ?time?");
+
+			const Network& network = *NetworkWrapper::validateArg(interp, objv[0])->engine;
+			Busy::check(&network, "network");
+
+			engine->save(
+				Tcl_GetStringFromObj(objv[1], NULL),
+				network,
+				objc > 2 ? phlib::TclUtils::getDouble(interp, objv[2]) : 0.0);
+
+			return TCL_OK;
+		}
+
+		/*
+		 * Returns time of the snapshot, run started at this time continues
+		 * the interrupted one.
+		 */
+		int load(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 2)
+				throw WrongNumArgs(interp, 0, objv, "networkInst fileName");
+
+			Network& network = *NetworkWrapper::validateArg(interp, objv[0])->engine;
+			Busy::check(&network, "network");
+
+			const double time = engine->load(
+				Tcl_GetStringFromObj(objv[1], NULL),
+				network);
+			Tcl_SetObjResult(interp, Tcl_NewDoubleObj(time));
+
+			return TCL_OK;
+		}
+
+		/*
+		 * Events go to callback script if given, to log file if its name is
+		 * not empty, otherwise they are kept until retrieved by "events".
+		 */
+		int detectEvents(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc < 1 || objc > 3)
+				throw WrongNumArgs(interp, 0, objv, "none | phase-slips | flux-entries | all ?fileName? ?callback?");
+
+			EventDetector::Params params;
+			const std::string kind = Tcl_GetStringFromObj(objv[0], NULL);
+			if ("none" == kind) {
+				engine->setEventDetector(0);
+				eventDetector.reset();
+				eventCallback.reset();
+				return TCL_OK;
+			} else if ("phase-slips" == kind) {
+				params.fluxEntries = false;
+			} else if ("flux-entries" == kind) {
+				params.phaseSlips = false;
+			} else if ("all" != kind) {
+				throw WrongArgValue(interp, "none | phase-slips | flux-entries | all");
+			}
+
+			if (objc > 1) {
+				params.fileName = Tcl_GetStringFromObj(objv[1], NULL);
+			}
+
+			boost::shared_ptr<EventCallback> callback;
+			if (objc > 2) {
+				callback.reset(new EventCallback(interp, objv[2]));
+				params.listener = callback.get();
+			}
+
+			boost::shared_ptr<EventDetector> detector(new EventDetector(params));
+			engine->setEventDetector(detector.get());
+			eventDetector = detector;
+			eventCallback = callback;
+
+			return TCL_OK;
+		}
+
+		// list of events detected since previous call, every event is {type time network index direction}
+		int events(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 0)
+				throw WrongNumArgs(interp, 0, objv, "");
+
+			Tcl_Obj* const list = Tcl_NewListObj(0, NULL);
+			if (eventDetector) {
+				const EventDetector::EventVector& events = eventDetector->getEvents();
+				for (EventDetector::EventVector::const_iterator i = events.begin(), last = events.end(); i != last; ++i) {
+					Tcl_ListObjAppendElement(interp, list, event(interp, *i));
+				}
+				eventDetector->clearEvents();
+			}
+			Tcl_SetObjResult(interp, list);
+
+			return TCL_OK;
+		}
+
+		static Tcl_Obj* event(Tcl_Interp * interp, const EventDetector::Event& e) {
+			Tcl_Obj* const items[] = {
+				Tcl_NewStringObj(EventDetector::typeName(e.type), -1),
+				Tcl_NewDoubleObj(e.time),
+				Tcl_NewLongObj(static_cast<long>(e.network)),
+				Tcl_NewLongObj(static_cast<long>(e.index)),
+				Tcl_NewIntObj(e.direction)
+			};
+			return Tcl_NewListObj(sizeof(items) / sizeof(*items), items);
+		}
+
+		static Tcl_Obj* stats(Tcl_Interp * interp, const RunStats& s) {
+			Tcl_Obj* const dict = Tcl_NewDictObj();
+			put(interp, dict, "rhsEvaluations", Tcl_NewWideIntObj(s.rhsEvaluations));
+			put(interp, dict, "acceptedSteps", Tcl_NewWideIntObj(s.acceptedSteps));
+			put(interp, dict, "rejectedSteps", Tcl_NewWideIntObj(s.rejectedSteps));
+			put(interp, dict, "timePoints", Tcl_NewWideIntObj(s.timePoints));
+			put(interp, dict, "minStep", Tcl_NewDoubleObj(s.minStep));
+			put(interp, dict, "maxStep", Tcl_NewDoubleObj(s.maxStep));
+			put(interp, dict, "meanStep", Tcl_NewDoubleObj(s.meanStep()));
+			put(interp, dict, "wallTime", Tcl_NewDoubleObj(s.wallTime));
+			put(interp, dict, "rhsTime", Tcl_NewDoubleObj(s.rhsTime));
+			put(interp, dict, "linearSolveTime", Tcl_NewDoubleObj(s.linearSolveTime));
+			put(interp, dict, "solverOverheadTime", Tcl_NewDoubleObj(s.overheadTime()));
+			put(interp, dict, "tracerTime", Tcl_NewDoubleObj(s.tracerTime));
+			put(interp, dict, "otherTime", Tcl_NewDoubleObj(s.otherTime()));
+			return dict;
+		}
+
+		static void put(Tcl_Interp * interp, Tcl_Obj* const dict, const char* const key, Tcl_Obj* const value) {
+			Tcl_DictObjPut(interp, dict, Tcl_NewStringObj(key, -1), value);
+		}
+
 		int addTracer(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
 			if (objc != 1)
 				throw WrongNumArgs(interp, 0, objv, "tracerInst");
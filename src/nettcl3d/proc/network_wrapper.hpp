@@ -18,6 +18,9 @@
 #include <boost/bind.hpp>
 #include <phlib/tclutils.h>
 #include "../calc/network.hpp"
+#include "../calc/checkpoint.hpp"
+#include "../calc/topology_file.hpp"
+#include "busy.hpp"
 #include "populator_wrapper.hpp"
 #include "contact_wrapper.hpp"
 #include "circuit_wrapper.hpp"
@@ -49,6 +52,10 @@ namespace proc {
 
 			const std::string cmd = Tcl_GetStringFromObj(objv[1], NULL);
 
+			if ("exists" != cmd && objc > 2 && isInstanceOf(objv[2])) {
+				Busy::check(validateArg(interp, objv[2])->engine.get(), "network");
+			}
+
 			try {
 				if ("create" == cmd) {
 					return create(interp, objc - 2, objv + 2);
@@ -62,8 +69,20 @@ namespace proc {
 					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::get));
 				}
 
+				else if ("save" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::save));
+				}
+
+				else if ("load" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::load));
+				}
+
+				else if ("save-topology" == cmd) {
+					return processInstance(clientData, interp, objc - 2, objv + 2, static_cast<InstanceHandler>(&NetworkWrapper::saveTopology));
+				}
+
 				else
-					throw WrongArgValue(interp, "create | exists | get");
+					throw WrongArgValue(interp, "create | exists | get | save | load | save-topology");
 			} catch (WrongNumArgs& ex) {
 				throw WrongNumArgs(interp, 2 + ex.objc, objv, ex.message);
 			}
@@ -137,6 +156,38 @@ namespace proc {
 			return TCL_OK;
 		}
 
+		int save(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 1)
+				throw WrongNumArgs(interp, 0, objv, "fileName");
+
+			Checkpoint().save(Tcl_GetStringFromObj(objv[0], NULL), *engine);
+
+			return TCL_OK;
+		}
+
+		/*
+		 * Replaces contents of the network, returns time of the snapshot.
+		 */
+		int load(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 1)
+				throw WrongNumArgs(interp, 0, objv, "fileName");
+
+			Checkpoint checkpoint;
+			checkpoint.load(Tcl_GetStringFromObj(objv[0], NULL), *engine);
+			Tcl_SetObjResult(interp, Tcl_NewDoubleObj(checkpoint.time));
+
+			return TCL_OK;
+		}
+
+		int saveTopology(ClientData /* clientData */, Tcl_Interp * interp, int objc, Tcl_Obj * CONST objv[]) {
+			if (objc != 1)
+				throw WrongNumArgs(interp, 0, objv, "fileName");
+
+			TopologyFile::save(Tcl_GetStringFromObj(objv[0], NULL), *engine);
+
+			return TCL_OK;
+		}
+
 		template <typename IndexBuilder, typename ElementCreator>
 		Tcl_Obj* makeList(Tcl_Interp * interp, int objc, Tcl_Obj* const objv[], IndexBuilder builder, ElementCreator creator) {
 			Tcl_Obj *ret = Tcl_NewListObj(0, NULL);
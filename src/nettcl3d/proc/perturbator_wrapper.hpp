@@ -18,6 +18,7 @@
 #include "../calc/abstract_perturbator.hpp"
 #include "../perturbator/null.hpp"
 #include "../perturbator/static.hpp"
+#include "../perturbator/dynamic.hpp"
 #include "wrapper.hpp"
 #include "rng_wrapper.hpp"
 
@@ -103,8 +104,58 @@ namespace proc {
 				perturbator = new perturbator::Static(params);
 			}
 
+			else if ("ac" == perturbatorType) {
+				if (objc < 3 || objc > 6)
+					throw WrongNumArgs(interp, 1, objv, "amplitudeVector frequency ?phase? ?startTime? ?tagExpr?");
+
+				FieldDrive::Params params(FieldDrive::AC, Point::fromVector(phlib::TclUtils::getDoubleVector(interp, objv[1])));
+				params.frequency = phlib::TclUtils::getDouble(interp, objv[2]);
+				if (objc > 3) {
+					params.phase = phlib::TclUtils::getDouble(interp, objv[3]);
+				}
+				if (objc > 4) {
+					params.start = phlib::TclUtils::getDouble(interp, objv[4]);
+				}
+				if (objc > 5) {
+					params.tagExpr = Tcl_GetStringFromObj(objv[5], NULL);
+				}
+
+				perturbator = new perturbator::Dynamic(params);
+			}
+
+			else if ("ramp" == perturbatorType) {
+				if (objc < 4 || objc > 5)
+					throw WrongNumArgs(interp, 1, objv, "amplitudeVector startTime duration ?tagExpr?");
+
+				FieldDrive::Params params(FieldDrive::RAMP, Point::fromVector(phlib::TclUtils::getDoubleVector(interp, objv[1])));
+				params.start = phlib::TclUtils::getDouble(interp, objv[2]);
+				params.duration = phlib::TclUtils::getDouble(interp, objv[3]);
+				if (objc > 4) {
+					params.tagExpr = Tcl_GetStringFromObj(objv[4], NULL);
+				}
+
+				perturbator = new perturbator::Dynamic(params);
+			}
+
+			else if ("pulse" == perturbatorType) {
+				if (objc < 4 || objc > 6)
+					throw WrongNumArgs(interp, 1, objv, "amplitudeVector startTime width ?frequency? ?tagExpr?");
+
+				FieldDrive::Params params(FieldDrive::PULSE, Point::fromVector(phlib::TclUtils::getDoubleVector(interp, objv[1])));
+				params.start = phlib::TclUtils::getDouble(interp, objv[2]);
+				params.duration = phlib::TclUtils::getDouble(interp, objv[3]);
+				if (objc > 4) {
+					params.frequency = phlib::TclUtils::getDouble(interp, objv[4]);
+				}
+				if (objc > 5) {
+					params.tagExpr = Tcl_GetStringFromObj(objv[5], NULL);
+				}
+
+				perturbator = new perturbator::Dynamic(params);
+			}
+
 			else
-				throw WrongArgValue(interp, "null | static");
+				throw WrongArgValue(interp, "null | static | ac | ramp | pulse");
 
 			PerturbatorWrapper* const pw = new PerturbatorWrapper(perturbator);
 			pw->addVarRefs(varRefs);
@@ -19,6 +19,7 @@
 #include "var_ref.hpp"
 #include "../calc/abstract_populator.hpp"
 #include "../populator/grid3d.hpp"
+#include "../populator/topology.hpp"
 
 namespace proc {
 
@@ -91,8 +92,15 @@ namespace proc {
 				}
 			}
 
+			else if ("topology" == methodName) {
+				if (objc != 2)
+					throw WrongNumArgs(interp, 1, objv, "fileName");
+
+				p = new populator::Topology(Tcl_GetStringFromObj(objv[1], NULL));
+			}
+
 			else
-				throw WrongArgValue(interp, "grid3d");
+				throw WrongArgValue(interp, "grid3d | topology");
 
 			PopulatorWrapper* wrp = new PopulatorWrapper(p);
 			wrp->addVarRefs(varRefs);
@@ -51,7 +51,7 @@ namespace tracer {
 			Statistics stat;
 
 			for (Network::IndexVector::const_iterator i = indices.begin(), last = indices.end(); i != last; ++i) {
-				stat.accum(network.contact(*i).voltage);
+				stat.accum(network.getVoltage(*i));
 			}
 
 			return stat;
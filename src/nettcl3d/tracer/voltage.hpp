@@ -25,7 +25,7 @@ namespace tracer {
 		}
 
 		void trace(std::ostream& s, const Network& network, const Network::index_type index) const {
-			s << network.contact(index).voltage;
+			s << network.getVoltage(index);
 		}
 
 		static const char* fileNameFormat() {
@@ -0,0 +1,148 @@
+/*
+ * util/thread_pool.hpp --
+ *
+ * This file is part of nettcl3d application.
+ *
+ * Copyright (c) 2012 Andrey V. Nakin <andrey.nakin@gmail.com>
+ * All rights reserved.
+ *
+ * See the file "COPYING" for information on usage and redistribution
+ * of this file, and for a DISCLAIMER OF ALL WARRANTIES.
+ *
+ */
+
+#ifndef UTIL_THREAD_POOL_HPP_
+#define UTIL_THREAD_POOL_HPP_
+
+#include <algorithm>
+#include <boost/noncopyable.hpp>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+/*
+ * Persistent pool of worker threads for data-parallel loops.
+ * The calling thread takes part in the work, so a pool of N threads
+ * starts N - 1 workers. A range is split into fixed-size chunks which
+ * are handed out dynamically; since every chunk is processed the same
+ * way regardless of which thread takes it, results do not depend on
+ * number of threads.
+ */
+class ThreadPool : boost::noncopyable {
+public:
+
+	struct Task {
+
+		virtual ~Task() {}
+
+		virtual void operator()(std::size_t first, std::size_t last) = 0;
+
+	};
+
+	explicit ThreadPool(unsigned const numOfThreads) :
+		task(0), size(0), chunkSize(1), next(0), generation(0), busy(0), stopping(false) {
+
+		for (unsigned i = 1; i < numOfThreads; ++i) {
+			workers.create_thread(boost::bind(&ThreadPool::work, this));
+		}
+	}
+
+	~ThreadPool() {
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		workers.join_all();
+	}
+
+	unsigned getNumOfThreads() const {
+		return static_cast<unsigned>(workers.size()) + 1;
+	}
+
+	/*
+	 * Calls task for every chunk of [0, size) and waits for completion.
+	 */
+	void run(Task& task, std::size_t const size, std::size_t const chunkSize) {
+		if (0 == workers.size() || size <= chunkSize) {
+			if (size > 0) {
+				task(0, size);
+			}
+			return;
+		}
+
+		{
+			boost::mutex::scoped_lock lock(mutex);
+			this->task = &task;
+			this->size = size;
+			this->chunkSize = chunkSize;
+			next.store(0);
+			busy = workers.size();
+			++generation;
+		}
+		wakeUp.notify_all();
+
+		process();
+
+		boost::mutex::scoped_lock lock(mutex);
+		while (busy > 0) {
+			done.wait(lock);
+		}
+	}
+
+	static unsigned hardwareConcurrency() {
+		return std::max(1u, boost::thread::hardware_concurrency());
+	}
+
+private:
+
+	boost::thread_group workers;
+	boost::mutex mutex;
+	boost::condition_variable wakeUp, done;
+
+	Task* task;
+	std::size_t size, chunkSize;
+	boost::atomic<std::size_t> next;
+	unsigned long generation;
+	std::size_t busy;
+	bool stopping;
+
+	void work() {
+		unsigned long seen = 0;
+
+		for (;;) {
+			{
+				boost::mutex::scoped_lock lock(mutex);
+				while (!stopping && generation == seen) {
+					wakeUp.wait(lock);
+				}
+				if (stopping) {
+					return;
+				}
+				seen = generation;
+			}
+
+			process();
+
+			boost::mutex::scoped_lock lock(mutex);
+			if (0 == --busy) {
+				done.notify_one();
+			}
+		}
+	}
+
+	void process() {
+		for (;;) {
+			const std::size_t first = next.fetch_add(chunkSize);
+			if (first >= size) {
+				break;
+			}
+			(*task)(first, std::min(size, first + chunkSize));
+		}
+	}
+
+};
+
+#endif /* UTIL_THREAD_POOL_HPP_ */